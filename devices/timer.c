@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 // TIMER_FREQ 가 특정 범위 안에 있는지 확인 
@@ -24,6 +26,18 @@
 static int64_t ticks;
 
 
+/* PIT count for one timer tick. */
+static uint16_t tick_count;
+
+/* Tickless idle.  If true, the idle thread stretches the PIT
+   period up to the next sleeper's deadline instead of taking an
+   interrupt every tick.  Controlled by kernel command-line option
+   "-tickless". */
+bool timer_tickless;
+static int64_t idle_skip;       /* Ticks covered by the stretched period, 0 if periodic. */
+static unsigned idle_count;     /* PIT count of the stretched period. */
+static bool reload_pending;     /* Restore tick_count at the next interrupt. */
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 // 타이머 틱당 반복 수를 나타냄. timer_calibrate() 에 의해 초기화됨
@@ -33,6 +47,8 @@ static intr_handler_func timer_interrupt; // 타이머 인터럽트를 처리하
 static bool too_many_loops (unsigned loops); // 주어진 반복횟수가 많은지 확인
 static void busy_wait (int64_t loops); // 주어진 반복횟수동안 busy waiting 을 수행
 static void real_time_sleep (int64_t num, int32_t denom); // 실제시간으로 일정기간 동안 대기하는 작업
+static void pit_program (uint16_t count);
+static uint16_t pit_read (void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
@@ -44,11 +60,9 @@ timer_init (void) {
 	// PIT의 입력 주파수를 TIMER_FREQ로 나누어서 최종적으로 설정할 타이머 카운터의 초기값을 계산	
 	// 8254 PIT은 일반적으로 1193180hz의 입력 주파수를 가짐
 	// TIMER_FREQ / 2를 더해주는 이유는 반올림을 위함
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	tick_count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
 	printf("timer init\n");
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_program (tick_count);
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -129,6 +143,63 @@ timer_nsleep (int64_t ns) {
 	real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, when nothing
+   else is runnable.  Stretches the current PIT period so that the
+   next interrupt arrives at tick DEADLINE, or as close to it as
+   the 16-bit counter allows.  The ticks skipped this way are
+   added back to `ticks' by the interrupt that ends the period or
+   by timer_idle_exit(). */
+void
+timer_idle_enter (int64_t deadline) {
+	uint16_t remaining;
+	int64_t skip;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* MLFQS needs its per-tick and per-second bookkeeping. */
+	if (!timer_tickless || thread_mlfqs || idle_skip > 0 || reload_pending)
+		return;
+
+	/* The interrupt ending the current tick is folded into the
+	   stretched period, so keep its remaining count as the base. */
+	remaining = pit_read ();
+	skip = deadline - ticks;
+	if (skip > (UINT16_MAX - remaining) / tick_count + 1)
+		skip = (UINT16_MAX - remaining) / tick_count + 1;
+	if (skip <= 1)
+		return;
+
+	idle_count = remaining + (skip - 1) * tick_count;
+	idle_skip = skip;
+	pit_program (idle_count);
+}
+
+/* Called by the idle thread after it wakes up.  If an interrupt
+   other than the timer's ended the halt, charges the whole ticks
+   that elapsed in the stretched period and lets the partial tick
+   run out before going back to periodic mode. */
+void
+timer_idle_exit (void) {
+	enum intr_level old_level = intr_disable ();
+
+	/* If the stretched period already ran out, its interrupt is
+	   still pending in the PIC and will do the catching up. */
+	outb (0x20, 0x0a);    /* OCW3: read IRR of the master PIC. */
+	if (idle_skip > 0 && (inb (0x20) & 1) == 0) {
+		unsigned elapsed = idle_count - pit_read ();
+		unsigned partial = elapsed % tick_count;
+
+		ticks += elapsed / tick_count;
+		thread_idle_ticks (elapsed / tick_count);
+		idle_skip = 0;
+
+		/* Mode 2 needs a count of at least 2. */
+		pit_program (tick_count - partial >= 2 ? tick_count - partial : 2);
+		reload_pending = true;
+	}
+	intr_set_level (old_level);
+}
+
 /* Prints timer sftatistics. */
 void
 timer_print_stats (void) {
@@ -137,26 +208,62 @@ timer_print_stats (void) {
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
 	// 타임 인터럽트 마다 슬립 리스트에서 시간이 다된 스레드들을 깨우고
 	// 그걸 레디리스트에 넣는다.
-	ticks++;
-	thread_tick ();
+	if (idle_skip > 0) {
+		/* End of a stretched idle period: catch up and go back to
+		   one interrupt per tick. */
+		ticks += idle_skip;
+		thread_idle_ticks (idle_skip - 1);
+		idle_skip = 0;
+		pit_program (tick_count);
+	} else {
+		ticks++;
+		if (reload_pending) {
+			reload_pending = false;
+			pit_program (tick_count);
+		}
+	}
+	if (trace_enabled)
+		trace_event (TRACE_TIMER, thread_tid (), ticks);
+	thread_tick (args);
 	
 	if(thread_mlfqs){
 		increase_recent_cpu_point();
-		// 100 틱마다 load_avg 계산
+		// 100 틱마다 load_avg 와 모든 스레드의 recent_cpu, priority 계산
 		if(timer_ticks() % TIMER_FREQ == 0){
 			load_avg = calculate_ad_avg();
 
 			refresh_all_thread_recent_cpu ();
 		}
-		// 4틱마다 priority 계산
+		// 4틱마다 그동안 실행된 스레드의 priority 계산
 		if(timer_ticks() % 4 == 0){
 			refresh_all_thread_priority();
 		}
 	}
 	thread_wakeup(ticks);
+	workqueue_tick (ticks);
+}
+
+/* Programs counter 0 of the PIT to interrupt every COUNT input
+   clocks. */
+static void
+pit_program (uint16_t count) {
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current value of PIT counter 0. */
+static uint16_t
+pit_read (void) {
+	uint8_t lo, hi;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -7,6 +7,7 @@
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static size_t free_map_hint;         /* Where the next search starts. */
 
 /* Initializes the free map. */
 void
@@ -24,15 +25,23 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	/* Next fit: carry on after the last allocation, so the
+	   allocated sectors at the front are not rescanned each time.
+	   Wrap around to the beginning before giving up. */
+	size_t sector = bitmap_scan_and_flip (free_map, free_map_hint, cnt,
+			false);
+	if (sector == BITMAP_ERROR && free_map_hint != 0)
+		sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
 		bitmap_set_multiple (free_map, sector, cnt, false);
 		sector = BITMAP_ERROR;
 	}
-	if (sector != BITMAP_ERROR)
+	if (sector != BITMAP_ERROR) {
 		*sectorp = sector;
+		free_map_hint = (sector + cnt) % bitmap_size (free_map);
+	}
 	return sector != BITMAP_ERROR;
 }
 
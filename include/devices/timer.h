@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -18,6 +19,11 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_idle_enter (int64_t deadline);
+void timer_idle_exit (void);
+
+extern bool timer_tickless;
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -0,0 +1,73 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/* Priority queue (pairing heap).
+ *
+ * Like the list and hash table, this heap does not require
+ * dynamic allocation.  Each structure that can be in a heap must
+ * embed a struct heap_elem member, and the heap_entry macro
+ * converts a struct heap_elem back to the structure that
+ * contains it.  See lib/kernel/list.h for a detailed explanation
+ * of the technique.
+ *
+ * The heap is a max-heap with respect to the LESS function given
+ * to heap_init(): heap_top() and heap_pop() return an element
+ * that no other element is greater than.  Elements that compare
+ * equal come out in insertion order.
+ *
+ * Push and top are O(1); pop and remove are O(log n) amortized.
+ *
+ * If the key of an element changes while it is in the heap, call
+ * heap_invalidate().  The heap is then rebuilt the next time its
+ * top is needed, so any number of key changes between two pops
+ * costs a single O(n log n) rebuild. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct heap_elem {
+	struct heap_elem *child;    /* First child. */
+	struct heap_elem *next;     /* Next sibling. */
+	struct heap_elem *prev;     /* Previous sibling, or parent if first child. */
+	uint64_t seq;               /* Insertion order, breaks ties. */
+};
+
+/* Converts pointer to heap element HEAP_ELEM into a pointer to
+ * the structure that HEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (HEAP_ELEM)            \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+		const struct heap_elem *b,
+		void *aux);
+
+/* Heap. */
+struct heap {
+	struct heap_elem *root;     /* Greatest element, or NULL if empty. */
+	size_t size;                /* Number of elements. */
+	uint64_t next_seq;          /* Sequence number for the next push. */
+	bool dirty;                 /* Keys changed since the last rebuild. */
+	heap_less_func *less;       /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+void heap_push (struct heap *, struct heap_elem *);
+struct heap_elem *heap_top (struct heap *);
+struct heap_elem *heap_pop (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_invalidate (struct heap *);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+
+#endif /* lib/kernel/heap.h */
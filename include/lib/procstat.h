@@ -0,0 +1,18 @@
+#ifndef __LIB_PROCSTAT_H
+#define __LIB_PROCSTAT_H
+
+/* CPU and scheduling statistics of one process, as returned by
+   the procstat() system call.  Ticks are timer ticks. */
+struct proc_stat {
+	int pid;                        /* Process identifier. */
+	char name[16];                  /* Process name. */
+	int priority;                   /* Current (effective) priority. */
+	long long user_ticks;           /* Ticks spent in user mode. */
+	long long kernel_ticks;         /* Ticks spent in the kernel. */
+	long long voluntary_switches;   /* Times it blocked. */
+	long long involuntary_switches; /* Times it was preempted. */
+	long long lock_wait_ticks;      /* Ticks spent waiting for locks. */
+	long long page_faults;          /* Page faults taken. */
+};
+
+#endif /* lib/procstat.h */
@@ -36,6 +36,13 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra: statistics. */
+	SYS_PROCSTAT,               /* Report a process's CPU statistics. */
+
+	/* Extra: scheduling. */
+	SYS_SETAFFINITY,            /* Restrict a process to some CPUs. */
+	SYS_GETAFFINITY,            /* Report the CPUs a process may use. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <procstat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,6 +38,9 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+bool procstat (pid_t pid, struct proc_stat *st);
+bool setaffinity (pid_t pid, unsigned mask);
+int getaffinity (pid_t pid);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
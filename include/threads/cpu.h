@@ -0,0 +1,59 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Maximum number of CPUs the kernel keeps state for.  Only
+   cpus[0], the bootstrap processor, is brought online; see cpu.c. */
+#define CPU_MAX 8
+
+/* Affinity mask naming every CPU; bit I stands for cpus[I]. */
+#define CPU_MASK_ALL ((1u << CPU_MAX) - 1)
+
+/* Run queue of one CPU.  There is one FIFO list per priority
+ * level, and bit P of `bitmap' is set whenever queues[P] is
+ * non-empty, so the highest-priority ready thread is found with a
+ * single bit scan.  Threads in the deadline class wait in `edf'
+ * instead, and run before any of the others.  `lock' must be held,
+ * with interrupts off, to touch any of it. */
+struct runqueue {
+	struct spinlock lock;               /* Protects the members below. */
+	struct list queues[PRI_MAX + 1];    /* Ready threads by priority. */
+	struct list edf;                    /* Ready deadline threads, earliest first. */
+	uint64_t bitmap;                    /* Non-empty queues. */
+	int cnt;                            /* # of threads in the queues. */
+};
+
+/* Per-CPU state. */
+struct cpu {
+	int id;                             /* Index in cpus[]. */
+	uint8_t apic_id;                    /* Local APIC ID. */
+	bool online;                        /* Scheduling threads? */
+	struct thread *curr;                /* Running thread. */
+	struct thread *idle;                /* This CPU's idle thread. */
+	struct runqueue rq;                 /* Threads ready to run here. */
+	int dl_util;                        /* Per-mille reserved by deadline threads. */
+	struct thread *fpu_owner;           /* Thread whose state is in the FPU. */
+
+	/* Scheduling. */
+	unsigned thread_ticks;              /* # of timer ticks since last yield. */
+
+	/* Statistics. */
+	long long idle_ticks;               /* # of timer ticks spent idle. */
+	long long kernel_ticks;             /* # of timer ticks in kernel mode. */
+	long long user_ticks;               /* # of timer ticks in user mode. */
+	long long migrations;               /* # of threads run here after another CPU. */
+	long long affinity_violations;      /* # of threads queued here against their mask. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+void cpu_init (void);
+struct cpu *this_cpu (void);
+
+#endif /* threads/cpu.h */
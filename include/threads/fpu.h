@@ -0,0 +1,16 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+#include <stdbool.h>
+
+struct thread;
+
+/* Size of an FXSAVE image of the x87, MMX and SSE registers. */
+#define FPU_STATE_SIZE 512
+
+void fpu_init (void);
+void fpu_switch (struct thread *next);
+bool fpu_fork (struct thread *child, struct thread *parent);
+void fpu_release (struct thread *);
+
+#endif /* threads/fpu.h */
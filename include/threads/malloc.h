@@ -3,8 +3,9 @@
 
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
 
-void malloc_init (void);
+void malloc_init (uint64_t mem_end);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
@@ -0,0 +1,15 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Saves the callee-saved registers of the running thread on its
+   own stack and stores the resulting stack pointer in *CUR_RSP.
+   If *NEXT_RSP is nonzero, resumes the thread that saved it there;
+   otherwise enters the next thread through NEXT_TF with iretq. */
+void switch_threads (uint64_t *cur_rsp, uint64_t *next_rsp,
+		struct intr_frame *next_tf);
+
+#endif /* threads/switch.h */
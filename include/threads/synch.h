@@ -1,28 +1,29 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_up_many (struct semaphore *, unsigned count);
 void sema_self_test (void);
-bool cmp_priority_in_synch (const struct list_elem *, const struct list_elem *, void *);
-bool cmp_sema_priority (const struct list_elem *, const struct list_elem *, void *);
-bool cmp_priority_in_donate (const struct list_elem *, const struct list_elem *, void * );
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int max_priority;           /* Highest priority waiting on the lock. */
+	struct list_elem elem;      /* Element in holder's held_locks. */
 };
 
 void lock_init (struct lock *);
@@ -30,10 +31,16 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
+
+/* If true, contended lock_acquire() yield-spins for a while before
+   blocking.  Controlled by kernel command-line option
+   "-adaptive-locks". */
+extern bool lock_adaptive;
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void cond_init (struct condition *);
@@ -41,6 +48,39 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Spinlock, for short critical sections such as the scheduler's
+   run queues.  Interrupts must be off while one is held.  With
+   only one CPU online it never spins; it marks the sections that
+   will need it once other CPUs run. */
+struct spinlock {
+	volatile int locked;        /* Nonzero while held. */
+};
+
+void spin_init (struct spinlock *);
+void spin_lock (struct spinlock *);
+void spin_unlock (struct spinlock *);
+bool spin_held (const struct spinlock *);
+
+/* Readers-writer lock. */
+struct rwlock {
+	struct lock write_lock;     /* Held by the writer, active or waiting. */
+	struct lock lock;           /* Protects the members below. */
+	struct condition no_readers; /* Signaled when `readers' drops to 0. */
+	struct condition upgraded;  /* Broadcast when an upgrade completes. */
+	unsigned readers;           /* Number of active readers. */
+	bool writer;                /* Write hold taken, active or waiting? */
+	bool upgrading;             /* A reader is in rw_upgrade()? */
+};
+
+void rw_init (struct rwlock *);
+void rw_read_acquire (struct rwlock *);
+void rw_read_release (struct rwlock *);
+void rw_write_acquire (struct rwlock *);
+void rw_write_release (struct rwlock *);
+bool rw_upgrade (struct rwlock *);
+void rw_downgrade (struct rwlock *);
+bool rw_write_held_by_current_thread (const struct rwlock *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
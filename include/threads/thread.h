@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include <procstat.h>
 #include "threads/interrupt.h"
 #include "synch.h"
 #include "threads/fixedpoint.h"
@@ -31,6 +33,26 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+struct cpu;
+
+/* Record of a thread, indexed by tid in thread.c's tid_table while
+ * the thread is alive.  For a thread created by
+ * thread_create_child(), the record is shared with the parent and
+ * outlives whichever of the two exits last, so the parent can
+ * collect the exit status of a child whose struct thread is long
+ * gone.  Otherwise it goes away with the thread. */
+struct child_info {
+	tid_t tid;                          /* Child's tid. */
+	struct thread *thread;              /* Child, or NULL once it has exited. */
+	int exit_status;                    /* Child's sys_stat at exit. */
+	bool fork_failed;                   /* __do_fork() could not copy the parent. */
+	int refcnt;                         /* Parent and/or child still using it. */
+	struct semaphore fork_sema;         /* Upped when fork copying is done. */
+	struct semaphore exit_sema;         /* Upped when the child exits. */
+	struct hash_elem elem;              /* For parent's `children'. */
+	struct hash_elem tid_elem;          /* For tid_table. */
+};
+
 /* A kernel thread or user process.
  *
  * Each thread structure is stored in its own 4 kB page.  The
@@ -93,32 +115,50 @@ struct thread {
 	enum thread_status status;          /* Thread state. */
 	char name[16];                  	/* Name (for debugging purposes). */
 	int priority;                       /* Priority. */
+	struct cpu *cpu;                    /* CPU it runs or is queued on. */
+	unsigned affinity;                  /* CPUs it may run on, see CPU_MASK_ALL. */
+
+	/* Deadline class, see thread_set_deadline().  Times in ticks. */
+	int64_t dl_runtime;                 /* Budget per period. */
+	int64_t dl_period;                  /* Period, or 0 if not in the class. */
+	int64_t dl_deadline;                /* End of the current period. */
+	int64_t dl_budget;                  /* Budget left in this period. */
+	bool dl_throttled;                  /* Out of budget until dl_deadline. */
+
+	/* Accounting, reported by thread_get_stat(). */
+	long long user_ticks;               /* Timer ticks in user mode. */
+	long long kernel_ticks;             /* Timer ticks in kernel mode. */
+	long long nvcsw;                    /* # of switches away by blocking. */
+	long long nivcsw;                   /* # of switches away by preemption. */
+	long long lock_wait_ticks;          /* Timer ticks waiting for locks. */
+	long long page_faults;              /* # of page faults. */
 	int origin_priority;				/* Never Changed Priority*/
-	int awake_ticks;					// 일어나야할 시간
+	int64_t awake_ticks;				// 일어나야할 시간
 	struct lock *wait_lock;				// 기다리는 락
-	struct list donated_threads;		// 기부해준 쓰레드들
+	struct list held_locks;				// 보유 중인 락들, max_priority 내림차순
+	struct heap *wait_heap;				// 대기 중인 세마포어/조건변수의 waiters
 	int sys_stat;
 
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
-	struct list_elem d_elem;			// 기부 쓰레드 연결 리스트용
-	struct list_elem c_elem;			// for child_list 
+	struct heap_elem h_elem;            /* Semaphore waiters element. */
 	struct list_elem a_elem;			// for all_list 
 
 	// add in advanced scheduler
 	int nice_point;						
 	fixedpoint recent_cpu_point;
+	bool recent_cpu_dirty;				/* On dirty_list? */
+	struct list_elem dirty_elem;		/* For dirty_list. */
 
 	/* syscall */
 	struct thread *parent;
 	int next_fd;
 	struct file *file_descripter_table[64];
 	struct intr_frame for_copy; 
-	struct semaphore fork_sema;
-	struct semaphore wait_sema;
-	struct semaphore exit_sema;
-	struct list child_list;
+	struct child_info *child_info;		// 부모와 공유하는 자신의 종료 기록
+	struct hash children;				// 자식들의 child_info, tid 로 찾음
+	bool has_children;					// children 초기화 여부 (첫 자식 때 생성)
 	/* ROX */
 	struct list file_list;
 	struct file *current_file;
@@ -135,8 +175,12 @@ struct thread {
 	struct supplemental_page_table spt;
 #endif
 
+	/* Owned by threads/fpu.c. */
+	uint8_t *fpu_area;                  /* FXSAVE area, or NULL. */
+
 	/* Owned by thread.c. */
 	struct intr_frame tf;               /* Information for switching */
+	uint64_t switch_rsp;                /* Saved rsp from switch_threads(), or 0. */
 	unsigned magic;                     /* Detects stack overflow. */
 };
 
@@ -145,27 +189,34 @@ struct priority_list {
 	struct list_elem *p_elem;
 };
 
-fixedpoint load_avg;
+extern fixedpoint load_avg;
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, always switch threads through a full intr_frame.
+   Controlled by kernel command-line option "-slow-switch". */
+extern bool thread_slow_switch;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (struct intr_frame *);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+tid_t thread_create_child (const char *name, int priority, thread_func *,
+		void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
 
-void thread_sleep (int);
-void thread_wakeup(int);
+void thread_sleep (int64_t);
+void thread_wakeup(int64_t);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -177,6 +228,12 @@ void thread_preemption(void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_change_priority (struct thread *, int);
+bool thread_set_deadline (int64_t runtime, int64_t period);
+bool thread_set_affinity (tid_t tid, unsigned mask);
+bool thread_get_affinity (tid_t tid, unsigned *mask);
+bool thread_get_stat (tid_t, struct proc_stat *);
+void select_maximum_donation (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -191,10 +248,13 @@ bool cmp_priority (const struct list_elem *a,const struct list_elem *b, void *au
 // 강철구 : 어드밴스트 스케쥴러
 int calculate_priority(struct thread *curr);
 void refresh_all_thread_priority (void);
+void refresh_all_thread_recent_cpu (void);
+void increase_recent_cpu_point (void);
+fixedpoint calculate_recent_cpu (struct thread *);
 fixedpoint calculate_ad_avg(void);
 
-struct thread *find_thread_for_tid(int tid);
-struct thread *find_child_for_tid(int tid);
+struct child_info *find_child_for_tid(int tid);
+void release_child (struct child_info *);
 
 
 
@@ -0,0 +1,27 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Kinds of scheduler trace events. */
+enum trace_type {
+	TRACE_SWITCH,       /* schedule(): TID switched to thread ARG. */
+	TRACE_BLOCK,        /* thread_block(): TID blocked. */
+	TRACE_UNBLOCK,      /* thread_unblock(): TID made ready. */
+	TRACE_LOCK_WAIT,    /* lock_acquire(): TID waits on lock held by ARG. */
+	TRACE_LOCK_GOT,     /* lock_acquire(): TID got a lock it waited on. */
+	TRACE_TIMER,        /* timer_interrupt(): tick ARG, TID running. */
+	TRACE_TYPE_CNT
+};
+
+/* If true, record scheduler events into per-CPU ring buffers.
+   Controlled by kernel command-line option "-trace". */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_event (enum trace_type, tid_t, int64_t arg);
+void trace_dump (void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,24 @@
+#ifndef THREADS_VMALLOC_H
+#define THREADS_VMALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Kernel virtual addresses reserved for vmalloc(), above the
+   direct mapping of physical memory. */
+#define VMALLOC_START 0xc000000000
+#define VMALLOC_PAGES 16384     /* 64 MB. */
+#define VMALLOC_END (VMALLOC_START + (uint64_t) VMALLOC_PAGES * PGSIZE)
+
+/* Returns true if VADDR lies in the vmalloc() area. */
+#define is_vmalloc_vaddr(vaddr) \
+	((uint64_t) (vaddr) >= VMALLOC_START && (uint64_t) (vaddr) < VMALLOC_END)
+
+void vmalloc_init (void);
+void *vmalloc (size_t size);
+void vfree (void *);
+size_t vmalloc_size (const void *);
+
+#endif /* threads/vmalloc.h */
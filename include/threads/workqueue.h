@@ -0,0 +1,60 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct work;
+struct workqueue;
+
+/* Function run by a worker thread for a piece of work.  It may
+   free or requeue WORK. */
+typedef void work_func (struct work *work);
+
+/* A piece of work, usually embedded in a larger structure and
+   recovered in its work_func with list_entry()-style arithmetic. */
+struct work {
+	struct list_elem elem;          /* In the queue's pending list. */
+	work_func *func;                /* Function to run. */
+	struct workqueue *wq;           /* Queue it was last put on. */
+	bool pending;                   /* Queued and not started yet. */
+};
+
+/* Work queued only once a number of timer ticks have passed. */
+struct delayed_work {
+	struct work work;
+	struct list_elem timer_elem;    /* In the list of armed timers. */
+	int64_t expires;                /* Tick at which to queue `work'. */
+	bool armed;                     /* Timer running? */
+};
+
+/* Shared queue for work that needs no dedicated workers. */
+extern struct workqueue *system_wq;
+
+void workqueue_init (void);
+void workqueue_start (void);
+void workqueue_tick (int64_t now);
+int64_t workqueue_next_expiry (void);
+
+struct workqueue *workqueue_create (const char *name, int workers,
+		int priority);
+
+void work_init (struct work *, work_func *);
+void delayed_work_init (struct delayed_work *, work_func *);
+
+bool queue_work (struct workqueue *, struct work *);
+bool queue_delayed_work (struct workqueue *, struct delayed_work *,
+		int64_t ticks);
+bool schedule_work (struct work *);
+bool schedule_delayed_work (struct delayed_work *, int64_t ticks);
+
+bool cancel_work (struct work *);
+bool cancel_work_sync (struct work *);
+bool cancel_delayed_work (struct delayed_work *);
+bool cancel_delayed_work_sync (struct delayed_work *);
+
+void flush_work (struct work *);
+void flush_workqueue (struct workqueue *);
+
+#endif /* threads/workqueue.h */
@@ -63,6 +63,49 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns an elem_type with the CNT bits starting at OFS, within
+   one element, turned on. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) {
+	elem_type mask = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : (elem_type) -1;
+	return mask << ofs;
+}
+
+/* Returns the number of bits set in E.  (__builtin_popcountl()
+   would need libgcc without -mpopcnt.) */
+static inline size_t
+elem_popcount (elem_type e) {
+	e = e - ((e >> 1) & 0x5555555555555555UL);
+	e = (e & 0x3333333333333333UL) + ((e >> 2) & 0x3333333333333333UL);
+	e = (e + (e >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (e * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the index of the first bit at or after START in B that
+   is set to VALUE, or B's size if there is none.  Looks at a whole
+   element at a time, so runs of !VALUE bits are skipped quickly. */
+static size_t
+find_next (const struct bitmap *b, size_t start, bool value) {
+	size_t idx = elem_idx (start);
+	size_t last = elem_cnt (b->bit_cnt);
+	elem_type e;
+
+	if (start >= b->bit_cnt)
+		return b->bit_cnt;
+
+	e = value ? b->bits[idx] : ~b->bits[idx];
+	e &= (elem_type) -1 << (start % ELEM_BITS);
+	while (e == 0) {
+		if (++idx >= last)
+			return b->bit_cnt;
+		e = value ? b->bits[idx] : ~b->bits[idx];
+	}
+
+	/* Bits past the end of B are never set, but inverted they are. */
+	start = idx * ELEM_BITS + __builtin_ctzl (e);
+	return start < b->bit_cnt ? start : b->bit_cnt;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -197,47 +240,57 @@ bitmap_set_all (struct bitmap *b, bool value) {
 /* Sets the CNT bits starting at START in B to VALUE. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		bitmap_set (b, start + i, value);
+	/* Set whole elements at a time, each one atomically. */
+	while (cnt > 0) {
+		size_t idx = elem_idx (start);
+		size_t ofs = start % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+		elem_type mask = range_mask (ofs, n);
+
+		if (value)
+			asm ("lock orq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+		else
+			asm ("lock andq %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+		start += n;
+		cnt -= n;
+	}
 }
 
 /* Returns the number of bits in B between START and START + CNT,
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t i, true_cnt;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	true_cnt = 0;
+	for (i = 0; i < cnt; ) {
+		size_t ofs = (start + i) % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < cnt - i ? ELEM_BITS - ofs : cnt - i;
+
+		true_cnt += elem_popcount (b->bits[elem_idx (start + i)]
+				& range_mask (ofs, n));
+		i += n;
+	}
+	return value ? true_cnt : cnt - true_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
-
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			return true;
-	return false;
+	return cnt > 0 && find_next (b, start, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -266,7 +319,9 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+   Jumps from each run of VALUE bits to the next, a whole element
+   at a time, instead of testing every candidate start bit. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
@@ -274,10 +329,21 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;
+
+		if (cnt == 0)
+			return start <= last ? start : BITMAP_ERROR;
+		while (i <= last) {
+			size_t end;
+
+			i = find_next (b, i, value);
+			if (i > last)
+				break;
+			end = find_next (b, i, !value);
+			if (end - i >= cnt)
 				return i;
+			i = end + 1;
+		}
 	}
 	return BITMAP_ERROR;
 }
@@ -0,0 +1,214 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Priority queue (pairing heap).
+
+   Every element has a list of children, threaded through the
+   `next' and `prev' members; the first child's `prev' points to
+   its parent.  The root is greater than or equal to all of its
+   descendants.  Two heaps are melded by making the smaller root
+   the first child of the greater one, and popping the root melds
+   its children back together in two passes.
+
+   See heap.h for basic information. */
+
+static bool before (const struct heap *, const struct heap_elem *,
+		const struct heap_elem *);
+static struct heap_elem *meld (struct heap *, struct heap_elem *,
+		struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void detach (struct heap_elem *);
+static void rebuild (struct heap *);
+
+/* Initializes H as an empty heap that orders its elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->size = 0;
+	h->next_seq = 0;
+	h->dirty = false;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	e->seq = h->next_seq++;
+	h->root = meld (h, h->root, e);
+	h->size++;
+}
+
+/* Returns the greatest element in H, which must not be empty. */
+struct heap_elem *
+heap_top (struct heap *h) {
+	ASSERT (!heap_empty (h));
+
+	if (h->dirty)
+		rebuild (h);
+	return h->root;
+}
+
+/* Removes and returns the greatest element in H, which must not
+   be empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top = heap_top (h);
+
+	h->root = merge_pairs (h, top->child);
+	h->size--;
+	top->child = top->next = top->prev = NULL;
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	ASSERT (!heap_empty (h));
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		h->root = merge_pairs (h, e->child);
+	} else {
+		detach (e);
+		h->root = meld (h, h->root, merge_pairs (h, e->child));
+	}
+	h->size--;
+	e->child = e->next = e->prev = NULL;
+}
+
+/* Notes that the key of one or more elements of H may have
+   changed.  H is reordered before its top is next returned. */
+void
+heap_invalidate (struct heap *h) {
+	ASSERT (h != NULL);
+
+	h->dirty = true;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) {
+	return h->size;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	return h->root == NULL;
+}
+
+/* Returns true if A must come out of H before B. */
+static bool
+before (const struct heap *h, const struct heap_elem *a,
+		const struct heap_elem *b) {
+	if (h->less (b, a, h->aux))
+		return true;
+	if (h->less (a, b, h->aux))
+		return false;
+	return a->seq < b->seq;
+}
+
+/* Melds the heaps rooted at A and B, either of which may be
+   NULL, and returns the new root. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (before (h, b, a)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	a->next = a->prev = NULL;
+	return a;
+}
+
+/* Melds the sibling list that starts at FIRST into one heap and
+   returns its root.  Siblings are melded in pairs from left to
+   right, then the pairs are melded from right to left.  Uses no
+   recursion, so long sibling lists cannot overflow the stack. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass: meld adjacent pairs, stacking the results on
+	   PAIRS through their `next' members. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a = meld (h, a, b);
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Second pass: meld the pairs, last one first. */
+	while (pairs != NULL) {
+		struct heap_elem *a = pairs;
+
+		pairs = a->next;
+		a->next = NULL;
+		root = meld (h, root, a);
+	}
+	if (root != NULL)
+		root->next = root->prev = NULL;
+	return root;
+}
+
+/* Unlinks non-root element E, along with its subtree, from its
+   parent's list of children. */
+static void
+detach (struct heap_elem *e) {
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+	e->next = e->prev = NULL;
+}
+
+/* Reorders H after its keys changed.  Pops every element, which
+   yields each of them exactly once even if the order is stale,
+   then melds them back in.  Sequence numbers are kept, so equal
+   elements stay in insertion order. */
+static void
+rebuild (struct heap *h) {
+	struct heap_elem *chain = NULL;
+
+	h->dirty = false;
+	while (h->root != NULL) {
+		struct heap_elem *e = h->root;
+
+		h->root = merge_pairs (h, e->child);
+		e->child = e->prev = NULL;
+		e->next = chain;
+		chain = e;
+	}
+	while (chain != NULL) {
+		struct heap_elem *e = chain;
+
+		chain = e->next;
+		e->next = NULL;
+		h->root = meld (h, h->root, e);
+	}
+}
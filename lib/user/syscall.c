@@ -194,3 +194,18 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+procstat (pid_t pid, struct proc_stat *st) {
+	return syscall2 (SYS_PROCSTAT, pid, st);
+}
+
+bool
+setaffinity (pid_t pid, unsigned mask) {
+	return syscall2 (SYS_SETAFFINITY, pid, mask);
+}
+
+int
+getaffinity (pid_t pid) {
+	return syscall1 (SYS_GETAFFINITY, pid);
+}
@@ -0,0 +1,47 @@
+/* Fills the file system up to the end of the disk, removes the
+   first file created, and verifies that a file of the same size
+   can be created again in the space it freed at the front. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FRONT_SIZE 20480
+
+static char buf[FRONT_SIZE];
+
+void
+test_main (void) 
+{
+  char file_name[16];
+  size_t size;
+  int fd;
+  int cnt = 0;
+
+  CHECK (create ("front", FRONT_SIZE), "create \"front\"");
+
+  /* Largest first, so that the remaining space at the end of the
+     disk is taken by ever smaller files. */
+  msg ("fill disk");
+  for (size = 8 * 1024 * 1024; size >= 512; size /= 2)
+    for (;;)
+      {
+        snprintf (file_name, sizeof file_name, "fill%d", cnt);
+        if (!create (file_name, size))
+          break;
+        cnt++;
+      }
+  if (cnt == 0)
+    fail ("could not create any fill file");
+
+  CHECK (remove ("front"), "remove \"front\"");
+  CHECK (create ("again", FRONT_SIZE), "create \"again\"");
+  CHECK ((fd = open ("again")) > 1, "open \"again\"");
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == FRONT_SIZE, "write \"again\"");
+  msg ("close \"again\"");
+  close (fd);
+  check_file ("again", buf, sizeof buf);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(full-reuse) begin
+(full-reuse) create "front"
+(full-reuse) fill disk
+(full-reuse) remove "front"
+(full-reuse) create "again"
+(full-reuse) open "again"
+(full-reuse) write "again"
+(full-reuse) close "again"
+(full-reuse) open "again" for verification
+(full-reuse) verified contents of "again"
+(full-reuse) close "again"
+(full-reuse) end
+EOF
+pass;
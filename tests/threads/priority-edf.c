@@ -0,0 +1,90 @@
+/* Checks the deadline scheduling class.  Admission control lets
+   the deadline threads of a CPU reserve up to 90% of it, counting
+   every thread's reservation, and refuses anything beyond.  A
+   deadline thread woken by the timer then preempts even a
+   PRI_MAX thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func greedy_thread;
+static thread_func edf_thread;
+static thread_func high_thread;
+
+static struct semaphore done;
+static volatile bool high_running;
+
+static const char *
+verdict (bool ok) 
+{
+  return ok ? "accepted" : "refused";
+}
+
+void
+test_priority_edf (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+
+  msg ("Reserving 5 of every 10 ticks: %s.",
+       verdict (thread_set_deadline (5, 10)));
+  msg ("Reserving 10 of every 10 ticks: %s.",
+       verdict (thread_set_deadline (10, 10)));
+  msg ("Reserving 9 of every 10 ticks: %s.",
+       verdict (thread_set_deadline (9, 10)));
+
+  /* A deadline thread outranks every priority thread, so GREEDY
+     only runs once we block. */
+  thread_create ("greedy", PRI_DEFAULT + 1, greedy_thread, NULL);
+  msg ("Greedy thread created.");
+  sema_down (&done);
+
+  thread_set_deadline (0, 0);
+  msg ("Back in the priority class.");
+
+  /* EDF_THREAD runs at once, enters the deadline class and sleeps;
+     HIGH_THREAD then spins until well after it is due to wake. */
+  thread_create ("edf", PRI_DEFAULT + 1, edf_thread, NULL);
+  thread_create ("high", PRI_MAX, high_thread, NULL);
+  msg ("Both threads have finished.");
+}
+
+static void
+greedy_thread (void *aux UNUSED) 
+{
+  msg ("Greedy: reserving 1 of every 10 ticks: %s.",
+       verdict (thread_set_deadline (1, 10)));
+  sema_up (&done);
+}
+
+static void
+edf_thread (void *aux UNUSED) 
+{
+  msg ("Deadline thread: reserving 2 of every 50 ticks: %s.",
+       verdict (thread_set_deadline (2, 50)));
+  timer_sleep (10);
+  msg ("Deadline thread: woke up %s the PRI_MAX thread finished.",
+       high_running ? "before" : "after");
+}
+
+static void
+high_thread (void *aux UNUSED) 
+{
+  int64_t start = timer_ticks ();
+
+  high_running = true;
+  msg ("Thread high spinning.");
+  while (timer_elapsed (start) < 30)
+    continue;
+  high_running = false;
+  msg ("Thread high done.");
+}
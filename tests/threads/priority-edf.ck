@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-edf) begin
+(priority-edf) Reserving 5 of every 10 ticks: accepted.
+(priority-edf) Reserving 10 of every 10 ticks: refused.
+(priority-edf) Reserving 9 of every 10 ticks: accepted.
+(priority-edf) Greedy thread created.
+(priority-edf) Greedy: reserving 1 of every 10 ticks: refused.
+(priority-edf) Back in the priority class.
+(priority-edf) Deadline thread: reserving 2 of every 50 ticks: accepted.
+(priority-edf) Thread high spinning.
+(priority-edf) Deadline thread: woke up before the PRI_MAX thread finished.
+(priority-edf) Thread high done.
+(priority-edf) Both threads have finished.
+(priority-edf) end
+EOF
+pass;
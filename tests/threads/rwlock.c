@@ -0,0 +1,95 @@
+/* Exercises the readers-writer lock on one CPU, using priorities
+   to order the threads: several readers hold it at once, a
+   waiting writer excludes both the reader it waits for and
+   readers arriving after it, an upgrade fails while a writer
+   waits and otherwise excludes readers, and a downgrade lets
+   blocked readers back in. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_hold_thread;
+static thread_func reader_thread;
+static thread_func writer_thread;
+
+static struct rwlock rw;
+static struct semaphore go;
+static int value;
+
+void
+test_rwlock (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rw_init (&rw);
+  sema_init (&go, 0);
+
+  /* Concurrent readers. */
+  rw_read_acquire (&rw);
+  thread_create ("reader 1", PRI_DEFAULT + 1, reader_hold_thread, "reader 1");
+  thread_create ("reader 2", PRI_DEFAULT + 1, reader_hold_thread, "reader 2");
+  msg ("%u readers inside at once.", rw.readers);
+  sema_up (&go);
+  sema_up (&go);
+  rw_read_release (&rw);
+
+  /* Writer exclusion, and writer preference over new readers. */
+  rw_read_acquire (&rw);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread, NULL);
+  msg ("Writer waiting for main to stop reading.");
+  thread_create ("late reader", PRI_DEFAULT + 2, reader_thread, "late reader");
+  msg ("Late reader queued behind the writer.");
+  if (rw_upgrade (&rw))
+    fail ("rw_upgrade() succeeded while a writer was waiting.");
+  msg ("Upgrade refused while a writer waits.");
+  rw_read_release (&rw);
+  msg ("Main done reading, value is %d.", value);
+
+  /* Upgrade. */
+  rw_read_acquire (&rw);
+  if (!rw_upgrade (&rw) || !rw_write_held_by_current_thread (&rw))
+    fail ("rw_upgrade() failed with no writer waiting.");
+  msg ("Upgraded to writer.");
+  thread_create ("reader 3", PRI_DEFAULT + 1, reader_thread, "reader 3");
+  msg ("Reader 3 blocked while main writes.");
+  value = 2;
+
+  /* Downgrade. */
+  rw_downgrade (&rw);
+  if (rw_write_held_by_current_thread (&rw))
+    fail ("still holding the write lock after rw_downgrade().");
+  msg ("Downgraded; %u reader(s) inside.", rw.readers);
+  rw_read_release (&rw);
+}
+
+/* Reads, then holds the lock until `go' is upped. */
+static void
+reader_hold_thread (void *name) 
+{
+  rw_read_acquire (&rw);
+  msg ("%s in.", (const char *) name);
+  sema_down (&go);
+  rw_read_release (&rw);
+}
+
+/* Reads once and reports what it saw. */
+static void
+reader_thread (void *name) 
+{
+  rw_read_acquire (&rw);
+  msg ("%s in, value is %d.", (const char *) name, value);
+  rw_read_release (&rw);
+}
+
+static void
+writer_thread (void *aux UNUSED) 
+{
+  rw_write_acquire (&rw);
+  msg ("Writer in, %u readers.", rw.readers);
+  value = 1;
+  rw_write_release (&rw);
+}
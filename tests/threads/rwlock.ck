@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock) begin
+(rwlock) reader 1 in.
+(rwlock) reader 2 in.
+(rwlock) 3 readers inside at once.
+(rwlock) Writer waiting for main to stop reading.
+(rwlock) Late reader queued behind the writer.
+(rwlock) Upgrade refused while a writer waits.
+(rwlock) Writer in, 0 readers.
+(rwlock) late reader in, value is 1.
+(rwlock) Main done reading, value is 1.
+(rwlock) Upgraded to writer.
+(rwlock) Reader 3 blocked while main writes.
+(rwlock) reader 3 in, value is 2.
+(rwlock) Downgraded; 1 reader(s) inside.
+(rwlock) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Measures the cost of a thread switch.  Two threads of equal
+   priority hand a pair of semaphores back and forth, so every
+   round is exactly two switches, and the main thread reports the
+   average number of TSC cycles per switch.
+
+   Run as switch-pingpong for the default (fast) switch path and
+   as switch-pingpong-slow, which boots with -slow-switch, for the
+   full intr_frame round trip; compare the two numbers. */
+
+#include <stdio.h>
+#include <intrinsic.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ROUNDS 10000
+
+static thread_func pong_thread;
+static struct semaphore ping, pong;
+
+void
+test_switch_pingpong (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  sema_init (&ping, 0);
+  sema_init (&pong, 0);
+  thread_create ("pong", thread_get_priority (), pong_thread, NULL);
+
+  /* Warm up so the pong thread has been switched out once. */
+  sema_up (&ping);
+  sema_down (&pong);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      sema_up (&ping);
+      sema_down (&pong);
+    }
+  cycles = rdtsc () - start;
+
+  msg ("%s path: %d rounds.", thread_slow_switch ? "slow" : "fast", ROUNDS);
+  msg ("%llu cycles per switch.",
+       (unsigned long long) (cycles / (2 * ROUNDS)));
+}
+
+static void
+pong_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ROUNDS + 1; i++) 
+    {
+      sema_down (&ping);
+      sema_up (&pong);
+    }
+}
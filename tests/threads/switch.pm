@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+sub check_switch_pingpong {
+    my ($path) = @_;
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    fail "Wrong switch path (expected $path).\n"
+      if !grep (/^\(switch-pingpong(?:-slow)?\) $path path: \d+ rounds\.$/, @output);
+    fail "No switch cost reported.\n"
+      if !grep (/^\(switch-pingpong(?:-slow)?\) \d+ cycles per switch\.$/, @output);
+    pass;
+}
+
+1;
@@ -29,6 +29,11 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"switch-pingpong", test_switch_pingpong},
+    {"switch-pingpong-slow", test_switch_pingpong},
+    {"workqueue-flush-cancel", test_workqueue_flush_cancel},
+    {"rwlock", test_rwlock},
+    {"priority-edf", test_priority_edf},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
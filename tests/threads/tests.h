@@ -23,6 +23,10 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_switch_pingpong;
+extern test_func test_workqueue_flush_cancel;
+extern test_func test_rwlock;
+extern test_func test_priority_edf;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,63 @@
+/* Checks that cancelling the only pending work wakes a thread
+   already waiting in flush_workqueue().
+
+   The queue's single worker runs at PRI_MIN, so the work stays
+   pending while a higher-priority thread starts flushing.  The
+   main thread then cancels the work; the flusher must return
+   even though no worker ever completes anything. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+static thread_func flusher_thread;
+static void work_func_ran (struct work *);
+
+static bool work_ran;
+static bool flush_returned;
+
+void
+test_workqueue_flush_cancel (void) 
+{
+  struct workqueue *wq;
+  struct work work;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  wq = workqueue_create ("flushq", 1, PRI_MIN);
+  ASSERT (wq != NULL);
+
+  work_init (&work, work_func_ran);
+  queue_work (wq, &work);
+  thread_create ("flusher", PRI_DEFAULT + 1, flusher_thread, wq);
+
+  msg ("Cancelling work.");
+  if (!cancel_work (&work))
+    fail ("cancel_work() found the work already started.");
+
+  /* Let the PRI_MIN worker run and find the queue empty. */
+  timer_sleep (10);
+
+  if (!flush_returned)
+    fail ("flush_workqueue() did not return after cancel_work().");
+  msg ("Work %s.", work_ran ? "ran" : "did not run");
+}
+
+static void
+flusher_thread (void *wq) 
+{
+  msg ("Flusher waiting.");
+  flush_workqueue (wq);
+  flush_returned = true;
+  msg ("Flush returned.");
+}
+
+static void
+work_func_ran (struct work *work UNUSED) 
+{
+  work_ran = true;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-flush-cancel) begin
+(workqueue-flush-cancel) Flusher waiting.
+(workqueue-flush-cancel) Cancelling work.
+(workqueue-flush-cancel) Flush returned.
+(workqueue-flush-cancel) Work did not run.
+(workqueue-flush-cancel) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Sets this process's CPU affinity mask and reads it back, checks
+   that bad masks and pids are rejected without changing anything,
+   and that a forked child inherits the mask.  Pid 0 names the
+   calling process. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int pid;
+
+  msg ("initial mask 0x%x", getaffinity (0));
+  CHECK (setaffinity (0, 0x1), "setaffinity(0x1)");
+  CHECK (getaffinity (0) == 0x1, "mask reads back as 0x1");
+
+  CHECK (!setaffinity (0, 0), "empty mask rejected");
+  CHECK (!setaffinity (0, 0x100), "mask beyond the last CPU rejected");
+  CHECK (!setaffinity (0, 0x2), "mask with no online CPU rejected");
+  CHECK (getaffinity (0) == 0x1, "mask still 0x1");
+
+  CHECK (!setaffinity ((pid_t) 0x0c020301, 0x1), "bad pid rejected by set");
+  CHECK (getaffinity ((pid_t) 0x0c020301) == -1, "bad pid rejected by get");
+
+  if ((pid = fork ("child"))) {
+    CHECK (wait (pid) == 81, "child inherited mask 0x1");
+    CHECK (!setaffinity (pid, 0x1), "exited child rejected by set");
+    CHECK (getaffinity (pid) == -1, "exited child rejected by get");
+  } else
+    exit (getaffinity (0) == 0x1 ? 81 : 1);
+}
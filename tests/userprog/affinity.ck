@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(affinity) begin
+(affinity) initial mask 0xff
+(affinity) setaffinity(0x1)
+(affinity) mask reads back as 0x1
+(affinity) empty mask rejected
+(affinity) mask beyond the last CPU rejected
+(affinity) mask with no online CPU rejected
+(affinity) mask still 0x1
+(affinity) bad pid rejected by set
+(affinity) bad pid rejected by get
+child: exit(81)
+(affinity) child inherited mask 0x1
+(affinity) exited child rejected by set
+(affinity) exited child rejected by get
+(affinity) end
+affinity: exit(0)
+EOF
+pass;
@@ -0,0 +1,90 @@
+/* Checks that a process's SSE registers survive fork() and a
+   context switch.  The parent fills XMM0...XMM7 and forks while
+   they hold the values; the child must see the same values.  The
+   child then loads values of its own, and the parent waits for it
+   with its registers still loaded, so they have to be saved and
+   restored around the child's run. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define XMM_CNT 8
+
+typedef uint8_t xmm_regs[XMM_CNT][16] __attribute__ ((aligned (16)));
+
+static xmm_regs parent_regs, child_regs, after_fork, after_wait;
+
+/* Loads XMM0...XMM7 from IN, makes system call NUM with argument
+   ARG while they hold those values, and stores them to OUT once
+   the call returns.  Returns the system call's return value. */
+static int64_t
+xmm_syscall (xmm_regs in, xmm_regs out, uint64_t num, uint64_t arg)
+{
+  int64_t ret;
+
+  __asm __volatile ("movdqa 0x00(%%rbx), %%xmm0\n"
+                    "movdqa 0x10(%%rbx), %%xmm1\n"
+                    "movdqa 0x20(%%rbx), %%xmm2\n"
+                    "movdqa 0x30(%%rbx), %%xmm3\n"
+                    "movdqa 0x40(%%rbx), %%xmm4\n"
+                    "movdqa 0x50(%%rbx), %%xmm5\n"
+                    "movdqa 0x60(%%rbx), %%xmm6\n"
+                    "movdqa 0x70(%%rbx), %%xmm7\n"
+                    "syscall\n"
+                    "movdqa %%xmm0, 0x00(%%rsi)\n"
+                    "movdqa %%xmm1, 0x10(%%rsi)\n"
+                    "movdqa %%xmm2, 0x20(%%rsi)\n"
+                    "movdqa %%xmm3, 0x30(%%rsi)\n"
+                    "movdqa %%xmm4, 0x40(%%rsi)\n"
+                    "movdqa %%xmm5, 0x50(%%rsi)\n"
+                    "movdqa %%xmm6, 0x60(%%rsi)\n"
+                    "movdqa %%xmm7, 0x70(%%rsi)\n"
+                    : "=a" (ret)
+                    : "a" (num), "D" (arg), "b" (in), "S" (out)
+                    : "rcx", "r11", "cc", "memory", "xmm0", "xmm1", "xmm2",
+                      "xmm3", "xmm4", "xmm5", "xmm6", "xmm7");
+  return ret;
+}
+
+void
+test_main (void) 
+{
+  int pid, status;
+  size_t i;
+
+  for (i = 0; i < sizeof parent_regs; i++)
+    {
+      ((uint8_t *) parent_regs)[i] = i + 1;
+      ((uint8_t *) child_regs)[i] = 0xff - i;
+    }
+
+  pid = xmm_syscall (parent_regs, after_fork, SYS_FORK,
+                     (uint64_t) "child");
+  if (pid == 0)
+    {
+      if (memcmp (after_fork, parent_regs, sizeof parent_regs))
+        fail ("child: registers differ from the parent's");
+      msg ("child: registers inherited");
+
+      /* wait() on a bad pid returns at once, but still enters the
+         kernel with this process's values loaded. */
+      xmm_syscall (child_regs, after_wait, SYS_WAIT, (uint64_t) -1);
+      if (memcmp (after_wait, child_regs, sizeof child_regs))
+        fail ("child: own registers lost");
+      msg ("child: own registers kept");
+      exit (42);
+    }
+
+  status = xmm_syscall (parent_regs, after_wait, SYS_WAIT, pid);
+  if (memcmp (after_fork, parent_regs, sizeof parent_regs))
+    fail ("parent: registers changed by fork");
+  msg ("parent: registers kept across fork");
+  if (memcmp (after_wait, parent_regs, sizeof parent_regs))
+    fail ("parent: registers changed while the child ran");
+  msg ("parent: registers kept while the child ran");
+  msg ("parent: child exit status is %d", status);
+}
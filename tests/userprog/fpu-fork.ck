@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-fork) begin
+(fpu-fork) child: registers inherited
+(fpu-fork) child: own registers kept
+child: exit(42)
+(fpu-fork) parent: registers kept across fork
+(fpu-fork) parent: registers kept while the child ran
+(fpu-fork) parent: child exit status is 42
+(fpu-fork) end
+fpu-fork: exit(0)
+EOF
+pass;
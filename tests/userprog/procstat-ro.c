@@ -0,0 +1,13 @@
+/* Passes a pointer into the read-only code segment to the procstat
+   system call.  The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  procstat (0, (struct proc_stat *) test_main);
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,44 @@
+/* Burns CPU in user mode and then in system calls, and checks
+   that procstat() charges the time to the right counter.  Pid 0
+   names the calling process. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Gives up after this many rounds without the counter being
+   watched having moved. */
+#define ROUND_LIMIT 100000
+
+void
+test_main (void) 
+{
+  struct proc_stat before, st;
+  volatile unsigned sum = 0;
+  unsigned i;
+  int round;
+
+  CHECK (procstat (0, &before), "procstat(0)");
+  CHECK (strcmp (before.name, "procstat-ticks") == 0,
+         "name is \"%s\"", before.name);
+
+  /* Spin mostly in user mode until a tick lands there. */
+  st = before;
+  for (round = 0; round < ROUND_LIMIT
+       && st.user_ticks == before.user_ticks; round++)
+    {
+      for (i = 0; i < 10000; i++)
+        sum += i;
+      procstat (0, &st);
+    }
+  CHECK (st.user_ticks > before.user_ticks, "user ticks increased");
+
+  /* Do nothing but system calls until a tick lands in the
+     kernel. */
+  before = st;
+  for (round = 0; round < ROUND_LIMIT * 100
+       && st.kernel_ticks == before.kernel_ticks; round++)
+    procstat (0, &st);
+  CHECK (st.kernel_ticks > before.kernel_ticks, "kernel ticks increased");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(procstat-ticks) begin
+(procstat-ticks) procstat(0)
+(procstat-ticks) name is "procstat-ticks"
+(procstat-ticks) user ticks increased
+(procstat-ticks) kernel ticks increased
+(procstat-ticks) end
+procstat-ticks: exit(0)
+EOF
+pass;
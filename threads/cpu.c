@@ -0,0 +1,60 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Per-CPU state.
+
+   This is single-CPU groundwork: the kernel runs on the bootstrap
+   processor (BSP) only, and cpu_cnt is always 1.  The scheduler
+   keeps its run queue, time slice and statistics in cpus[0] rather
+   than in globals, so that per-CPU state has one home, but nothing
+   here schedules on a second CPU.
+
+   The application processors are not started.  That needs a
+   real-mode trampoline, an INIT-SIPI-SIPI sequence through the
+   local APIC, a GDT, TSS and idle thread for each of them, and the
+   kernel's intr_disable()-based critical sections converted to
+   locks; until then the run queue spinlocks never see contention. */
+struct cpu cpus[CPU_MAX];
+int cpu_cnt;
+
+/* Initializes the state of the BSP.  Called by thread_init(),
+   before any thread is queued. */
+void
+cpu_init (void) {
+	struct cpu *c = &cpus[0];
+	uint32_t ebx;
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	memset (c, 0, sizeof *c);
+	c->id = 0;
+
+	/* CPUID leaf 1 returns the initial local APIC ID in EBX[31:24]. */
+	asm volatile ("cpuid" : "=b" (ebx) : "a" (1) : "ecx", "edx");
+	c->apic_id = ebx >> 24;
+
+	spin_init (&c->rq.lock);
+	for (i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&c->rq.queues[i]);
+	list_init (&c->rq.edf);
+	c->online = true;
+	cpu_cnt = 1;
+}
+
+/* Returns the CPU the caller is running on.  Each CPU runs on the
+   kernel stack of its own current thread, and the scheduler keeps
+   that thread's `cpu' member up to date, so this needs no per-CPU
+   segment register.  Interrupts must be off, or the caller could
+   migrate before using the result. */
+struct cpu *
+this_cpu (void) {
+	struct thread *t = (struct thread *) pg_round_down (rrsp ());
+
+	ASSERT (intr_get_level () == INTR_OFF || cpu_cnt == 1);
+	return t->cpu;
+}
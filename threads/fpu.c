@@ -0,0 +1,173 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/slab.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* Lazy FPU context switching.
+
+   The kernel itself is built without x87 or SSE code, so only user
+   programs touch these registers, and most of them never do.
+   Instead of saving and restoring 512 bytes on every switch, we
+   set CR0.TS whenever the CPU switches to a thread other than the
+   one whose state is loaded in the FPU (the CPU's fpu_owner).  The
+   first FPU or SSE instruction that thread executes raises #NM;
+   fpu_trap() then saves the owner's registers, loads the new
+   thread's, and makes it the owner.  A thread's save area is only
+   allocated on its first such trap, from a slab cache. */
+
+#define CR0_MP 0x00000002       /* Monitor coprocessor. */
+#define CR0_EM 0x00000004       /* x87 emulation. */
+#define CR0_TS 0x00000008       /* Task switched. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE/FXRSTOR and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SIMD exceptions delivered as #XM. */
+
+/* Save areas, FXSAVE needs them 16-byte aligned. */
+static struct kmem_cache *fpu_cache;
+
+/* FPU state right after FNINIT, copied into every new save area. */
+static uint8_t fpu_initial_state[FPU_STATE_SIZE] __attribute__ ((aligned (16)));
+
+static void fpu_trap (struct intr_frame *);
+
+static void
+fxsave (void *state) {
+	__asm __volatile ("fxsave64 (%0)" : : "r" (state) : "memory");
+}
+
+static void
+fxrstor (void *state) {
+	__asm __volatile ("fxrstor64 (%0)" : : "r" (state) : "memory");
+}
+
+static void
+clts (void) {
+	__asm __volatile ("clts");
+}
+
+static void
+stts (void) {
+	lcr0 (rcr0 () | CR0_TS);
+}
+
+/* Turns on the FPU and SSE, records their reset state, and
+   installs the #NM handler.  FPU instructions trap until the
+   first user thread needs them. */
+void
+fpu_init (void) {
+	lcr0 ((rcr0 () & ~(CR0_EM | CR0_TS)) | CR0_MP);
+	lcr4 (rcr4 () | CR4_OSFXSR | CR4_OSXMMEXCPT);
+	__asm __volatile ("fninit");
+	fxsave (fpu_initial_state);
+	stts ();
+
+	fpu_cache = kmem_cache_create ("fpu", FPU_STATE_SIZE, 16, NULL);
+	if (fpu_cache == NULL)
+		PANIC ("fpu_init: out of memory");
+
+	intr_register_int (7, 0, INTR_OFF, fpu_trap,
+			"#NM Device Not Available Exception");
+}
+
+/* Called by schedule() just before switching to NEXT: lets NEXT
+   use the FPU directly if its state is already loaded, and makes
+   its first FPU instruction trap otherwise. */
+void
+fpu_switch (struct thread *next) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (this_cpu ()->fpu_owner == next)
+		clts ();
+	else
+		stts ();
+}
+
+/* Gives CHILD a copy of PARENT's FPU state.  Called by the child
+   during fork(), while PARENT waits for it.  Returns false if
+   memory is exhausted. */
+bool
+fpu_fork (struct thread *child, struct thread *parent) {
+	enum intr_level old_level;
+
+	ASSERT (child == thread_current ());
+
+	if (parent->fpu_area == NULL)
+		return true;
+	child->fpu_area = kmem_cache_alloc (fpu_cache);
+	if (child->fpu_area == NULL)
+		return false;
+
+	old_level = intr_disable ();
+	if (this_cpu ()->fpu_owner == parent) {
+		/* PARENT's latest state is still in the registers. */
+		clts ();
+		fxsave (child->fpu_area);
+		stts ();
+	} else
+		memcpy (child->fpu_area, parent->fpu_area, FPU_STATE_SIZE);
+	intr_set_level (old_level);
+	return true;
+}
+
+/* Discards T's FPU state, on exit or exec.  T's next FPU
+   instruction, if any, starts again from the reset state. */
+void
+fpu_release (struct thread *t) {
+	enum intr_level old_level;
+	uint8_t *area;
+
+	old_level = intr_disable ();
+	if (t->cpu != NULL && t->cpu->fpu_owner == t) {
+		t->cpu->fpu_owner = NULL;
+		if (t == thread_current ())
+			stts ();
+	}
+	area = t->fpu_area;
+	t->fpu_area = NULL;
+	intr_set_level (old_level);
+
+	kmem_cache_free (fpu_cache, area);
+}
+
+/* #NM handler: loads the current thread's FPU state, saving the
+   previous owner's first. */
+static void
+fpu_trap (struct intr_frame *f) {
+	struct thread *curr = thread_current ();
+	struct cpu *cpu;
+
+	if (f->cs != SEL_UCSEG) {
+		intr_dump_frame (f);
+		PANIC ("Kernel bug - FPU instruction in kernel");
+	}
+
+	if (curr->fpu_area == NULL) {
+		uint8_t *area;
+
+		intr_enable ();
+		area = kmem_cache_alloc (fpu_cache);
+		if (area == NULL) {
+			printf ("%s: out of memory for FPU state.\n", thread_name ());
+			curr->sys_stat = -1;
+			thread_exit ();
+		}
+		intr_disable ();
+		curr->fpu_area = area;
+		memcpy (curr->fpu_area, fpu_initial_state, FPU_STATE_SIZE);
+	}
+
+	cpu = this_cpu ();
+	clts ();
+	if (cpu->fpu_owner != curr) {
+		if (cpu->fpu_owner != NULL)
+			fxsave (cpu->fpu_owner->fpu_area);
+		fxrstor (curr->fpu_area);
+		cpu->fpu_owner = curr;
+	}
+}
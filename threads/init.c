@@ -13,14 +13,20 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/thread.h"
+#include "threads/vmalloc.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -84,8 +90,11 @@ main (void) {
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
-	malloc_init ();
+	malloc_init (mem_end);
+	slab_init ();
 	paging_init (mem_end);
+	vmalloc_init ();
+	trace_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -94,6 +103,8 @@ main (void) {
 
 	/* Initialize interrupt handlers. */
 	intr_init ();
+	fpu_init ();
+	workqueue_init ();
 	timer_init ();
 	kbd_init ();
 	input_init ();
@@ -103,6 +114,7 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_start ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -221,6 +233,14 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-slow-switch"))
+			thread_slow_switch = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-adaptive-locks"))
+			lock_adaptive = true;
+		else if (!strcmp (name, "-trace"))
+			trace_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -325,6 +345,10 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -slow-switch       Switch threads through a full intr_frame.\n"
+			"  -tickless          Skip timer ticks while the CPU is idle.\n"
+			"  -adaptive-locks    Yield to a runnable lock holder before blocking.\n"
+			"  -trace             Record scheduler events, dump them at shutdown.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -353,6 +377,9 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	lock_print_stats ();
+	kmem_cache_print_stats ();
+	trace_dump ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -5,17 +5,24 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "threads/vmalloc.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the next
+   size class and assigned to the "descriptor" that manages blocks
+   of that size.  The classes are the powers of 2 up to 1 kB,
+   followed by the largest block sizes that fit 3, 2, and 1 blocks
+   into a page and 4 blocks into 3 pages, so that a request
+   between 1 kB and 3 kB takes a third, a half, or three quarters
+   of a page rather than a whole one.  The descriptor keeps a list
+   of free blocks.  If the free list is
+   nonempty, one of its blocks is used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -23,23 +30,73 @@
    into blocks, all of which are added to the descriptor's free
    list.  Then we return one of the new blocks.
 
+   The arena header sits at the start of the arena's first page,
+   so a block in a one-page arena finds it by rounding down to a
+   page boundary.  The 3-page arenas have blocks that start in
+   their second and third pages, so for those pages we record in
+   `arena_back', indexed by physical page number, how many pages
+   back the header is.
+
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   We can't handle blocks bigger than a page minus the arena
+   header using this scheme.  We hand those to vmalloc(), which
+   maps individual pages at contiguous kernel virtual addresses,
+   so that a large buffer does not need a contiguous run of
+   physical pages.  Before vmalloc_init() (or if the vmalloc area
+   is exhausted) we fall back to allocating contiguous pages with
+   the page allocator and sticking the allocation size at the
+   beginning of the allocated block's arena header.
+
+   In front of each descriptor's free list, every CPU keeps two
+   "magazines", small stacks of free blocks: a loaded one and the
+   previous one.  malloc() pops from the loaded magazine and free()
+   pushes onto it with interrupts off, without taking the
+   descriptor's lock.  When the loaded magazine runs empty (or
+   full), it trades places with the previous one.  Only when both
+   are empty (or full) does the CPU take the lock and exchange a
+   whole magazine at the descriptor's "depot" for a full (or empty)
+   one.  The depot holds at most DEPOT_MAX full magazines; beyond
+   that, blocks go back to the free list so that arenas can still
+   be given back.  Blocks in magazines count as in use as far as
+   their arenas are concerned.  Descriptors with fewer than
+   MAG_MIN_BLOCKS blocks per page skip the magazines, since every
+   cached block would pin most of a page. */
+
+#define MAG_ROUNDS 16           /* Blocks per magazine. */
+#define DEPOT_MAX 4             /* Full magazines kept per descriptor. */
+#define MAG_MIN_BLOCKS 4        /* Fewest blocks per page using magazines. */
+
+/* Magazine. */
+struct magazine {
+	struct list_elem elem;      /* In a depot list or mag_pool. */
+	size_t cnt;                 /* Number of blocks in `rounds'. */
+	void *rounds[MAG_ROUNDS];   /* Free blocks, last in first out. */
+};
+
+/* A CPU's magazines for one descriptor.  Interrupts must be off to
+   touch them. */
+struct mag_pair {
+	struct magazine *loaded;    /* Used first, or null. */
+	struct magazine *previous;  /* Used when `loaded' runs out, or null. */
+};
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	size_t pages_per_arena;     /* Number of pages in an arena. */
+	bool magazines;             /* Cache blocks in per-CPU magazines? */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Depot, protected by `lock'. */
+	struct list full_mags;      /* Full magazines. */
+	size_t full_cnt;            /* Number of full magazines. */
+	struct list empty_mags;     /* Empty magazines. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -58,25 +115,57 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[11];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Per-CPU magazines, by descriptor. */
+static struct mag_pair mag_pairs[CPU_MAX][sizeof descs / sizeof *descs];
+
+/* For each physical page, the number of pages from the start of
+   the arena it belongs to.  Zero except in the later pages of
+   multi-page arenas. */
+static uint8_t *arena_back;
+
+/* Unused magazines, carved out of whole pages. */
+static struct list mag_pool;
+static struct lock mag_lock;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
-
-/* Initializes the malloc() descriptors. */
+static void block_free (struct desc *, struct block *);
+static void arena_set_back (struct arena *, size_t page_cnt, bool);
+static struct mag_pair *mag_pair (struct desc *);
+static void *mag_pop (struct mag_pair *);
+static bool mag_push (struct mag_pair *, void *);
+static struct magazine *mag_alloc (void);
+static void desc_init (size_t block_size, size_t page_cnt);
+
+/* Initializes the malloc() descriptors.  MEM_END is the end of
+   physical memory, as returned by palloc_init(). */
 void
-malloc_init (void) {
+malloc_init (uint64_t mem_end) {
+	/* Size classes that fill an arena of `pages' pages with
+	   `blocks' blocks, in increasing order of block size. */
+	static const struct {
+		size_t blocks;
+		size_t pages;
+	} fills[] = { {3, 1}, {2, 1}, {4, 3}, {1, 1} };
 	size_t block_size;
+	size_t i;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
-		lock_init (&d->lock);
-	}
+	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+		desc_init (block_size, 1);
+
+	for (i = 0; i < sizeof fills / sizeof *fills; i++)
+		desc_init (ROUND_DOWN ((fills[i].pages * PGSIZE
+						- sizeof (struct arena)) / fills[i].blocks, 8),
+				fills[i].pages);
+
+	arena_back = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+			DIV_ROUND_UP (pg_no (mem_end), PGSIZE));
+
+	list_init (&mag_pool);
+	lock_init (&mag_lock);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -86,6 +175,8 @@ malloc (size_t size) {
 	struct desc *d;
 	struct block *b;
 	struct arena *a;
+	struct mag_pair *mp;
+	enum intr_level old_level;
 
 	/* A null pointer satisfies a request for 0 bytes. */
 	if (size == 0)
@@ -98,8 +189,13 @@ malloc (size_t size) {
 			break;
 	if (d == descs + desc_cnt) {
 		/* SIZE is too big for any descriptor.
-		   Allocate enough pages to hold SIZE plus an arena. */
+		   Map it in the vmalloc() area if we can.  Otherwise,
+		   allocate enough pages to hold SIZE plus an arena. */
 		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+		void *p = vmalloc (size);
+		if (p != NULL)
+			return p;
+
 		a = palloc_get_multiple (0, page_cnt);
 		if (a == NULL)
 			return NULL;
@@ -112,18 +208,49 @@ malloc (size_t size) {
 		return a + 1;
 	}
 
+	/* Fast path: this CPU's magazines. */
+	if (d->magazines) {
+		old_level = intr_disable ();
+		b = mag_pop (mag_pair (d));
+		intr_set_level (old_level);
+		if (b != NULL)
+			return b;
+	}
+
 	lock_acquire (&d->lock);
 
+	/* Both magazines are empty: trade the previous one for a full
+	   one from the depot.  We may have slept on the lock, so look
+	   at the magazines again first. */
+	old_level = intr_disable ();
+	mp = mag_pair (d);
+	b = mag_pop (mp);
+	if (b == NULL && !list_empty (&d->full_mags)) {
+		if (mp->previous != NULL)
+			list_push_front (&d->empty_mags, &mp->previous->elem);
+		mp->previous = mp->loaded;
+		mp->loaded = list_entry (list_pop_front (&d->full_mags),
+				struct magazine, elem);
+		d->full_cnt--;
+		b = mag_pop (mp);
+	}
+	intr_set_level (old_level);
+	if (b != NULL) {
+		lock_release (&d->lock);
+		return b;
+	}
+
 	/* If the free list is empty, create a new arena. */
 	if (list_empty (&d->free_list)) {
 		size_t i;
 
-		/* Allocate a page. */
-		a = palloc_get_page (0);
+		/* Allocate the arena's pages. */
+		a = palloc_get_multiple (0, d->pages_per_arena);
 		if (a == NULL) {
 			lock_release (&d->lock);
 			return NULL;
 		}
+		arena_set_back (a, d->pages_per_arena, true);
 
 		/* Initialize arena and add its blocks to the free list. */
 		a->magic = ARENA_MAGIC;
@@ -167,9 +294,14 @@ calloc (size_t a, size_t b) {
 static size_t
 block_size (void *block) {
 	struct block *b = block;
-	struct arena *a = block_to_arena (b);
-	struct desc *d = a->desc;
+	struct arena *a;
+	struct desc *d;
 
+	if (is_vmalloc_vaddr (block))
+		return vmalloc_size (block);
+
+	a = block_to_arena (b);
+	d = a->desc;
 	return d != NULL ? d->block_size : PGSIZE * a->free_cnt - pg_ofs (block);
 }
 
@@ -200,6 +332,11 @@ realloc (void *old_block, size_t new_size) {
    malloc(), calloc(), or realloc(). */
 void
 free (void *p) {
+	if (is_vmalloc_vaddr (p)) {
+		vfree (p);
+		return;
+	}
+
 	if (p != NULL) {
 		struct block *b = p;
 		struct arena *a = block_to_arena (b);
@@ -207,27 +344,68 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			struct magazine *m;
+			struct mag_pair *mp;
+			enum intr_level old_level;
+			bool cached;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
+			if (!d->magazines) {
+				lock_acquire (&d->lock);
+				block_free (d, b);
+				lock_release (&d->lock);
+				return;
+			}
 
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+			/* Fast path: this CPU's magazines. */
+			old_level = intr_disable ();
+			cached = mag_push (mag_pair (d), b);
+			intr_set_level (old_level);
+			if (cached)
+				return;
 
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
+			lock_acquire (&d->lock);
 
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
+			/* Both magazines are full: move the previous one to the
+			   depot and start an empty one. */
+			if (!list_empty (&d->empty_mags))
+				m = list_entry (list_pop_front (&d->empty_mags),
+						struct magazine, elem);
+			else
+				m = mag_alloc ();
+
+			old_level = intr_disable ();
+			mp = mag_pair (d);
+			cached = mag_push (mp, b);
+			if (!cached && m != NULL) {
+				if (mp->previous != NULL) {
+					list_push_front (&d->full_mags, &mp->previous->elem);
+					d->full_cnt++;
 				}
-				palloc_free_page (a);
+				mp->previous = mp->loaded;
+				mp->loaded = m;
+				m = NULL;
+				cached = mag_push (mp, b);
+			}
+			intr_set_level (old_level);
+
+			if (m != NULL)
+				list_push_front (&d->empty_mags, &m->elem);
+			if (!cached)
+				block_free (d, b);
+
+			/* Keep the depot small, so that arenas can drain. */
+			while (d->full_cnt > DEPOT_MAX) {
+				m = list_entry (list_pop_front (&d->full_mags),
+						struct magazine, elem);
+				d->full_cnt--;
+				while (m->cnt > 0)
+					block_free (d, m->rounds[--m->cnt]);
+				list_push_front (&d->empty_mags, &m->elem);
 			}
 
 			lock_release (&d->lock);
@@ -242,16 +420,20 @@ free (void *p) {
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
-	struct arena *a = pg_round_down (b);
+	uint8_t *page = pg_round_down (b);
+	struct arena *a;
+
+	ASSERT (page != NULL);
+	a = (struct arena *) (page - arena_back[pg_no (vtop (page))] * PGSIZE);
 
 	/* Check that the arena is valid. */
-	ASSERT (a != NULL);
 	ASSERT (a->magic == ARENA_MAGIC);
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+			|| ((uint8_t *) b - (uint8_t *) (a + 1))
+				% a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || (void *) b == a + 1);
 
 	return a;
 }
@@ -266,3 +448,124 @@ arena_to_block (struct arena *a, size_t idx) {
 			+ sizeof *a
 			+ idx * a->desc->block_size);
 }
+
+/* Returns block B to D's free list, giving its arena back to the
+   page allocator if that leaves the arena entirely unused.  D's
+   lock must be held. */
+static void
+block_free (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	ASSERT (lock_held_by_current_thread (&d->lock));
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		arena_set_back (a, d->pages_per_arena, false);
+		palloc_free_multiple (a, d->pages_per_arena);
+	}
+}
+
+/* Records in `arena_back' that the PAGE_CNT pages starting at A
+   belong to arena A if IN_USE is true, or clears the record if it
+   is false. */
+static void
+arena_set_back (struct arena *a, size_t page_cnt, bool in_use) {
+	size_t first = pg_no (vtop (a));
+	size_t i;
+
+	for (i = 1; i < page_cnt; i++)
+		arena_back[first + i] = in_use ? i : 0;
+}
+
+/* Adds a descriptor for blocks of BLOCK_SIZE bytes in arenas of
+   PAGE_CNT pages. */
+static void
+desc_init (size_t block_size, size_t page_cnt) {
+	struct desc *d = &descs[desc_cnt++];
+
+	ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+	ASSERT (page_cnt <= UINT8_MAX);
+	d->block_size = block_size;
+	d->pages_per_arena = page_cnt;
+	d->blocks_per_arena = (page_cnt * PGSIZE - sizeof (struct arena))
+		/ block_size;
+	d->magazines = d->blocks_per_arena / page_cnt >= MAG_MIN_BLOCKS;
+	list_init (&d->free_list);
+	lock_init (&d->lock);
+	list_init (&d->full_mags);
+	d->full_cnt = 0;
+	list_init (&d->empty_mags);
+}
+
+/* Returns the running CPU's magazines for D.  Interrupts must be
+   off. */
+static struct mag_pair *
+mag_pair (struct desc *d) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	return &mag_pairs[this_cpu ()->id][d - descs];
+}
+
+/* Pops a block from MP, switching to the previous magazine if the
+   loaded one is empty.  Returns a null pointer if both are empty.
+   Interrupts must be off. */
+static void *
+mag_pop (struct mag_pair *mp) {
+	if (mp->loaded == NULL || mp->loaded->cnt == 0) {
+		struct magazine *m = mp->previous;
+
+		if (m == NULL || m->cnt == 0)
+			return NULL;
+		mp->previous = mp->loaded;
+		mp->loaded = m;
+	}
+	return mp->loaded->rounds[--mp->loaded->cnt];
+}
+
+/* Pushes block B onto MP, switching to the previous magazine if the
+   loaded one is full.  Returns false if both are full (or
+   missing).  Interrupts must be off. */
+static bool
+mag_push (struct mag_pair *mp, void *b) {
+	if (mp->loaded == NULL || mp->loaded->cnt == MAG_ROUNDS) {
+		struct magazine *m = mp->previous;
+
+		if (m == NULL || m->cnt == MAG_ROUNDS)
+			return false;
+		mp->previous = mp->loaded;
+		mp->loaded = m;
+	}
+	mp->loaded->rounds[mp->loaded->cnt++] = b;
+	return true;
+}
+
+/* Returns a new, empty magazine, or a null pointer if memory is
+   not available. */
+static struct magazine *
+mag_alloc (void) {
+	struct magazine *m = NULL;
+
+	lock_acquire (&mag_lock);
+	if (list_empty (&mag_pool)) {
+		struct magazine *page = palloc_get_page (0);
+		size_t i;
+
+		for (i = 0; page != NULL && i < PGSIZE / sizeof *page; i++)
+			list_push_back (&mag_pool, &page[i].elem);
+	}
+	if (!list_empty (&mag_pool)) {
+		m = list_entry (list_pop_front (&mag_pool), struct magazine, elem);
+		m->cnt = 0;
+	}
+	lock_release (&mag_lock);
+	return m;
+}
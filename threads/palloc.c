@@ -7,7 +7,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <list.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -24,15 +26,47 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  Free memory is kept as blocks of 2**ORDER pages,
+   each aligned to its own size relative to the pool base, on one
+   free list per order.  An allocation of PAGE_CNT pages takes the
+   smallest block that fits, splitting larger blocks in half as
+   needed, and hands the unused tail of the block straight back.
+   Freeing a block merges it with its "buddy", the other half of
+   the block it was split from, for as long as the buddy is free
+   too.  Both take O(log n) time in the size of the pool.  Free
+   blocks are linked through their first page; `orders' records
+   which pages start a free block and of which order.
+
+   The free lists are protected by a spinlock taken with interrupts
+   off, not by a struct lock: the scheduler frees dead threads'
+   pages from do_schedule(), in the middle of a context switch,
+   where sleeping is not allowed.  Every critical section is a
+   handful of list operations per order, so this costs little
+   interrupt latency. */
+
+/* Largest block is 2**MAX_ORDER pages. */
+#define MAX_ORDER 20
+
+/* `orders' value for pages that do not start a free block. */
+#define ORDER_NONE 0xff
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct spinlock lock;           /* Mutual exclusion. */
+	struct bitmap *used_map;        /* Bitmap of used pages. */
+	uint8_t *orders;                /* Order of each free block's first page. */
+	struct list free_lists[MAX_ORDER + 1]; /* Free blocks, by order. */
 	uint8_t *base;                  /* Base of pool. */
 };
 
+/* A free block, stored in its first page. */
+struct free_block {
+	struct list_elem elem;          /* Element in a free list. */
+};
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
@@ -42,6 +76,8 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +260,13 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free (pool, page_idx, page_cnt);
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				buddy_free (pool, page_idx, page_cnt);
 			}
 		}
 	}
@@ -263,9 +301,16 @@ void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
+	if (page_cnt == 0)
+		return NULL;
+
+	enum intr_level old_level = intr_disable ();
+	spin_lock (&pool->lock);
+	size_t page_idx = buddy_alloc (pool, page_cnt);
+	if (page_idx != BITMAP_ERROR)
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	spin_unlock (&pool->lock);
+	intr_set_level (old_level);
 	void *pages;
 
 	if (page_idx != BITMAP_ERROR)
@@ -301,6 +346,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	enum intr_level old_level;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -318,8 +364,13 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
+	old_level = intr_disable ();
+	spin_lock (&pool->lock);
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	buddy_free (pool, page_idx, page_cnt);
+	spin_unlock (&pool->lock);
+	intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -331,22 +382,109 @@ palloc_free_page (void *page) {
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map and orders at its base.
+     Calculate the space needed for them
      and subtract it from the pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
-	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
-
-	lock_init(&p->lock);
-	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
+	size_t bm_size = bitmap_buf_size (pgcnt);
+	size_t bm_pages = DIV_ROUND_UP (bm_size + pgcnt, PGSIZE) * PGSIZE;
+	int order;
+
+	spin_init (&p->lock);
+	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_size);
+	p->orders = (uint8_t *) *bm_base + bm_size;
+	for (order = 0; order <= MAX_ORDER; order++)
+		list_init (&p->free_lists[order]);
 	p->base = (void *) start;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	memset (p->orders, ORDER_NONE, pgcnt);
 
 	*bm_base += bm_pages;
 }
 
+/* Returns the free block header of page PAGE_IDX in POOL. */
+static struct free_block *
+idx_to_block (struct pool *pool, size_t page_idx) {
+	return (struct free_block *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX to POOL's free
+   lists, merging it with its buddy as long as the buddy is free
+   as well. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t pgcnt = bitmap_size (pool->used_map);
+
+	while (order < MAX_ORDER) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+		if (buddy >= pgcnt || pool->orders[buddy] != order)
+			break;
+		list_remove (&idx_to_block (pool, buddy)->elem);
+		pool->orders[buddy] = ORDER_NONE;
+		if (buddy < page_idx)
+			page_idx = buddy;
+		order++;
+	}
+	pool->orders[page_idx] = order;
+	list_push_front (&pool->free_lists[order],
+			&idx_to_block (pool, page_idx)->elem);
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL, as the
+   largest aligned blocks they can be cut into.  POOL's lock must
+   be held, except during initialization. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order < MAX_ORDER
+				&& (page_idx & ((size_t) 1 << order)) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages out of POOL's free lists and
+   returns the index of the first one, or BITMAP_ERROR if no free
+   block is large enough.  POOL's lock must be held. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+	int order = 0, o;
+
+	while (((size_t) 1 << order) < page_cnt)
+		if (++order > MAX_ORDER)
+			return BITMAP_ERROR;
+
+	/* Find the smallest free block that fits. */
+	for (o = order; o <= MAX_ORDER; o++)
+		if (!list_empty (&pool->free_lists[o]))
+			break;
+	if (o > MAX_ORDER)
+		return BITMAP_ERROR;
+
+	page_idx = pg_no (list_pop_front (&pool->free_lists[o]))
+		- pg_no (pool->base);
+	pool->orders[page_idx] = ORDER_NONE;
+
+	/* Split it down to ORDER, freeing the upper halves. */
+	while (o > order) {
+		o--;
+		free_block (pool, page_idx + ((size_t) 1 << o), o);
+	}
+
+	/* Give back the pages past PAGE_CNT. */
+	buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
 /* Returns true if PAGE was allocated from POOL,
    false otherwise. */
 static bool
@@ -0,0 +1,264 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects.
+
+   malloc() rounds each request up to a power of 2, so an object
+   just over a power of 2 wastes almost half of its block.  A
+   cache instead hands out objects of one exact size, carved out
+   of page-sized "slabs".  Each slab starts with a header, followed
+   by an array of free-list indexes ("bufctls") and then the
+   objects themselves:
+
+      +--------+---------+-----+-------+-------+-----+-------+
+      |  slab  | bufctls | pad | obj 0 | obj 1 | ... | obj N |
+      +--------+---------+-----+-------+-------+-----+-------+
+
+   Free objects are chained through the bufctls rather than
+   through the objects, so an object keeps the state its
+   constructor gave it while it sits in the cache.  Callers must
+   hand objects back in that state.
+
+   A cache keeps its slabs on three lists, by whether all, some or
+   none of their objects are in use, and allocates from partial
+   slabs first to keep the number of slabs low.  It holds on to at
+   most one empty slab; other slabs that empty out go back to the
+   page allocator. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Marks the end of a slab's free chain. */
+#define BUFCTL_END UINT16_MAX
+
+/* An object cache. */
+struct kmem_cache {
+	const char *name;           /* For statistics. */
+	size_t obj_size;            /* Object size, including padding. */
+	size_t obj_offset;          /* Offset of object 0 in a slab. */
+	size_t objs_per_slab;       /* # of objects in a slab. */
+	kmem_ctor_func *ctor;       /* Constructor, or null. */
+	struct lock lock;           /* Protects the members below. */
+	struct list full;           /* Slabs with no free objects. */
+	struct list partial;        /* Slabs with some free objects. */
+	struct list empty;          /* Slabs with no objects in use. */
+	size_t slab_cnt;            /* # of slabs. */
+	size_t in_use;              /* # of objects handed out. */
+	long long allocs;           /* # of kmem_cache_alloc() calls. */
+	long long frees;            /* # of kmem_cache_free() calls. */
+	struct list_elem elem;      /* In `caches'. */
+};
+
+/* Header of one slab, at the start of its page. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* In one of the cache's slab lists. */
+	size_t in_use;              /* # of objects handed out. */
+	uint16_t free;              /* First free object, or BUFCTL_END. */
+	uint16_t bufctl[];          /* Next free object after each one. */
+};
+
+/* All caches, for kmem_cache_print_stats(). */
+static struct list caches;
+static struct lock caches_lock;
+
+static struct slab *slab_create (struct kmem_cache *);
+static void *slab_obj (struct kmem_cache *, struct slab *, size_t idx);
+
+/* Initializes the slab allocator.  Must be called after
+   malloc_init(). */
+void
+slab_init (void) {
+	list_init (&caches);
+	lock_init (&caches_lock);
+}
+
+/* Creates and returns a cache of SIZE-byte objects, each aligned
+   to ALIGN bytes, a power of 2 (or 0 for pointer alignment).  If
+   CTOR is nonnull, it is run on every object as its slab is
+   created.  NAME must outlive the cache.  Returns a null pointer
+   if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, size_t align,
+		kmem_ctor_func *ctor) {
+	struct kmem_cache *c;
+	size_t n;
+
+	if (align < sizeof (void *))
+		align = sizeof (void *);
+	ASSERT ((align & (align - 1)) == 0);
+	ASSERT (size > 0);
+
+	c = malloc (sizeof *c);
+	if (c == NULL)
+		return NULL;
+	c->name = name;
+	c->obj_size = ROUND_UP (size, align);
+	c->ctor = ctor;
+
+	/* Fit as many objects as possible behind the header and their
+	   bufctls. */
+	n = (PGSIZE - sizeof (struct slab)) / (c->obj_size + sizeof (uint16_t));
+	while (n > 0 && ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+				align) + n * c->obj_size > PGSIZE)
+		n--;
+	ASSERT (n > 0 && n < BUFCTL_END);
+	c->objs_per_slab = n;
+	c->obj_offset = ROUND_UP (sizeof (struct slab) + n * sizeof (uint16_t),
+			align);
+
+	lock_init (&c->lock);
+	list_init (&c->full);
+	list_init (&c->partial);
+	list_init (&c->empty);
+	c->slab_cnt = 0;
+	c->in_use = 0;
+	c->allocs = 0;
+	c->frees = 0;
+
+	lock_acquire (&caches_lock);
+	list_push_back (&caches, &c->elem);
+	lock_release (&caches_lock);
+	return c;
+}
+
+/* Returns an object from cache C, in the state its constructor
+   left it, or a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	ASSERT (c != NULL);
+
+	lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else if (!list_empty (&c->empty)) {
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		list_push_front (&c->partial, &s->elem);
+	} else {
+		s = slab_create (c);
+		if (s == NULL) {
+			lock_release (&c->lock);
+			return NULL;
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = slab_obj (c, s, s->free);
+	s->free = s->bufctl[s->free];
+	if (++s->in_use == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->in_use++;
+	c->allocs++;
+	lock_release (&c->lock);
+	return obj;
+}
+
+/* Returns OBJ, which must have come from cache C, to C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s;
+	size_t idx;
+
+	if (obj == NULL)
+		return;
+
+	s = pg_round_down (obj);
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((pg_ofs (obj) - c->obj_offset) % c->obj_size == 0);
+	idx = (pg_ofs (obj) - c->obj_offset) / c->obj_size;
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   that would destroy its constructed state. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	lock_acquire (&c->lock);
+	s->bufctl[idx] = s->free;
+	s->free = idx;
+	if (s->in_use-- == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->in_use == 0) {
+		list_remove (&s->elem);
+		if (list_empty (&c->empty))
+			list_push_front (&c->empty, &s->elem);
+		else {
+			c->slab_cnt--;
+			palloc_free_page (s);
+		}
+	}
+	c->in_use--;
+	c->frees++;
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache that has been used. */
+void
+kmem_cache_print_stats (void) {
+	struct list_elem *e;
+
+	lock_acquire (&caches_lock);
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		if (c->allocs == 0)
+			continue;
+		printf ("Slab: %s: %zu-byte objects, %zu per slab, %zu slabs, "
+				"%zu in use, %lld allocs, %lld frees\n",
+				c->name, c->obj_size, c->objs_per_slab, c->slab_cnt,
+				c->in_use, c->allocs, c->frees);
+	}
+	lock_release (&caches_lock);
+}
+
+/* Allocates and returns a new, empty slab for C, with every
+   object constructed.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->in_use = 0;
+	s->free = 0;
+	for (i = 0; i < c->objs_per_slab; i++) {
+		s->bufctl[i] = i + 1 < c->objs_per_slab ? i + 1 : BUFCTL_END;
+		if (c->ctor != NULL)
+			c->ctor (slab_obj (c, s, i));
+	}
+	c->slab_cnt++;
+	return s;
+}
+
+/* Returns the IDX'th object in slab S of cache C. */
+static void *
+slab_obj (struct kmem_cache *c, struct slab *s, size_t idx) {
+	ASSERT (idx < c->objs_per_slab);
+	return (uint8_t *) s + c->obj_offset + idx * c->obj_size;
+}
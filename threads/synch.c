@@ -29,8 +29,33 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+
+/* Number of times a contended lock_acquire() yields to a runnable
+   holder before blocking, in adaptive mode. */
+#define LOCK_SPIN_LIMIT 4
+
+/* Adaptive locking.  See synch.h. */
+bool lock_adaptive;
+
+/* Statistics for adaptive locking. */
+static long long spin_count;    /* # of contended acquires that spun. */
+static long long spin_hits;     /* # of those that got the lock spinning. */
+
+static bool lock_spin (struct lock *);
+static void priority_nested_donate (struct thread *, struct lock *);
+static void lock_hold (struct lock *);
+static int sema_max_waiter_priority (struct semaphore *);
+static void sema_wake (struct semaphore *);
+static bool cmp_lock_priority (const struct list_elem *,
+		const struct list_elem *, void *aux);
+static bool waiter_priority_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
+static bool sema_elem_priority_less (const struct heap_elem *,
+		const struct heap_elem *, void *aux);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +71,7 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	heap_init (&sema->waiters, waiter_priority_less, NULL);
 }
 
 /*
@@ -72,10 +97,17 @@ sema_down (struct semaphore *sema) {
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
-	while (sema->value == 0) {   
-      list_insert_ordered(&sema->waiters, &thread_current ()->elem,
-         cmp_priority, NULL);
+	while (sema->value == 0) {
+      struct thread *curr = thread_current ();
+      // cond_wait 중이면 조건변수의 waiters 순서가 우선이므로 덮어쓰지 않는다
+      bool own_heap = curr->wait_heap == NULL;
+
+      if (own_heap)
+         curr->wait_heap = &sema->waiters;
+      heap_push (&sema->waiters, &curr->h_elem);
 		thread_block ();
+      if (own_heap)
+         curr->wait_heap = NULL;
 	}
 	sema->value--;
 	intr_set_level (old_level);
@@ -129,17 +161,42 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 	old_level = intr_disable ();
 
-	if (!list_empty (&sema->waiters)){
-      list_sort(&sema->waiters, cmp_priority_in_synch, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters), 
-         struct thread, elem));
-   }
-   
-	sema->value++;
+	sema_wake (sema);
    thread_preemption();
 	intr_set_level (old_level);
 }
 
+/* Ups SEMA COUNT times, waking up to COUNT of its waiters, highest
+   priority first.  All of them are made ready before the single
+   check for preemption at the end, so the caller is not switched
+   out halfway through.
+
+   This function may be called from an interrupt handler. */
+void
+sema_up_many (struct semaphore *sema, unsigned count) {
+	enum intr_level old_level;
+
+	ASSERT (sema != NULL);
+	old_level = intr_disable ();
+
+	while (count-- > 0)
+		sema_wake (sema);
+	thread_preemption ();
+	intr_set_level (old_level);
+}
+
+/* The body of sema_up() without the preemption check.
+   Interrupts must be off. */
+static void
+sema_wake (struct semaphore *sema) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!heap_empty (&sema->waiters))
+		thread_unblock (heap_entry (heap_pop (&sema->waiters),
+					struct thread, h_elem));
+	sema->value++;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* 
@@ -199,6 +256,7 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->max_priority = PRI_MIN - 1;
 	sema_init (&lock->semaphore, 1);
 }
 
@@ -217,43 +275,133 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
    struct thread *curr = thread_current();   
-   // printf("\n %s \n", curr->name);
-   // lock holder 가 이미 있는 경우 wait lock 에 현재 락을 저장한 뒤 
-   if(!thread_mlfqs){
-      if (lock->holder != NULL) {
-         // 필요한 락을 저장
-         curr->wait_lock = lock;
-         // // 기부자들을 저장
-         list_insert_ordered(&lock->holder->donated_threads, &curr->d_elem, 
-            cmp_priority_in_donate, NULL);
-         // 우선순위를 기부
-         priority_nested_donate(curr, lock, 8);
-      }
+   struct thread *holder = lock->holder;
+   int64_t wait_start = 0;
+
+   if (holder != NULL) {
+      trace_event (TRACE_LOCK_WAIT, curr->tid, holder->tid);
+      wait_start = timer_ticks ();
+   }
+
+   // 홀더가 곧 놓아줄 것 같으면 잠들기 전에 잠깐 양보하며 기다린다
+   if (lock_adaptive && holder != NULL && lock_spin (lock)) {
+      trace_event (TRACE_LOCK_GOT, curr->tid, 0);
+      curr->lock_wait_ticks += timer_elapsed (wait_start);
+      return;
+   }
+
+   enum intr_level old_level = intr_disable ();
+
+   // lock holder 가 이미 있는 경우 wait lock 에 현재 락을 저장한 뒤 우선순위를 기부
+   if(!thread_mlfqs && lock->holder != NULL){
+      curr->wait_lock = lock;
+      priority_nested_donate(curr, lock);
    }
    //////////////////////////////////
    sema_down (&lock->semaphore);
    //////////////////////////////////
    curr->wait_lock = NULL;
    lock->holder = curr;
+   lock_hold (lock);
+   if (holder != NULL) {
+      trace_event (TRACE_LOCK_GOT, curr->tid, 0);
+      curr->lock_wait_ticks += timer_elapsed (wait_start);
+   }
+   intr_set_level (old_level);
+}
 
+/* Adaptive path of lock_acquire().  As long as LOCK's holder is
+   ready to run, donates to it and yields so that it can finish its
+   critical section, then retries LOCK, up to LOCK_SPIN_LIMIT
+   times.  Returns true if LOCK was acquired, false if the caller
+   should block instead. */
+static bool
+lock_spin (struct lock *lock) {
+   struct thread *curr = thread_current ();
+   enum intr_level old_level;
+   bool acquired = false;
+   bool spun = false;
+   int i;
+
+   for (i = 0; i < LOCK_SPIN_LIMIT && !acquired; i++) {
+      struct thread *holder;
+
+      old_level = intr_disable ();
+      holder = lock->holder;
+
+      acquired = lock_try_acquire (lock);
+      // 홀더가 디스크 I/O 등으로 잠들어 있으면 돌아봐야 소용없다
+      if (!acquired && holder != NULL && holder->status == THREAD_BLOCKED) {
+         intr_set_level (old_level);
+         break;
+      }
+      if (!acquired && holder != NULL && !thread_mlfqs)
+         priority_nested_donate (curr, lock);
+      intr_set_level (old_level);
+
+      if (!acquired) {
+         thread_yield ();
+         spun = true;
+      }
+   }
+
+   // 홀더가 잠들어 있어 바로 포기한 경우는 세지 않는다
+   if (spun || acquired) {
+      old_level = intr_disable ();
+      spin_count++;
+      if (acquired)
+         spin_hits++;
+      intr_set_level (old_level);
+   }
+   return acquired;
 }
 
-void priority_nested_donate(struct thread *donation, struct lock *lock, int depth) {
-   // 만약 기부 받은 우선순위가 자기보다 크면 자기의 우선순위와 바꾼다
-   struct thread *curr = donation;
+/* Donates DONOR's priority along the chain of lock holders that
+   starts at LOCK, the lock DONOR is about to wait on.  Each lock
+   remembers the highest priority waiting on it, so the walk stops
+   as soon as a lock or holder already has at least that priority;
+   otherwise it follows wait_lock links to any depth.  Interrupts
+   must be off. */
+static void
+priority_nested_donate (struct thread *donor, struct lock *lock) {
+   int priority = donor->priority;
 
-   for(int i = 0; i < depth; i++){
-      
-      if (curr->wait_lock == NULL) break;
+   ASSERT (intr_get_level () == INTR_OFF);
 
-      struct thread *holder = curr->wait_lock->holder;
+   while (lock != NULL && lock->holder != NULL) {
+      struct thread *holder = lock->holder;
 
-      holder->priority = curr->priority;
+      if (priority <= lock->max_priority)
+         break;
+      lock->max_priority = priority;
+      list_remove (&lock->elem);
+      list_insert_ordered (&holder->held_locks, &lock->elem,
+            cmp_lock_priority, NULL);
 
-      curr = holder;
+      if (priority <= holder->priority)
+         break;
+      thread_change_priority (holder, priority);
+      lock = holder->wait_lock;
    }
 }
 
+/* Records LOCK, just acquired by the current thread, among the
+   locks it holds.  The remaining waiters of LOCK now donate to the
+   current thread.  Interrupts must be off. */
+static void
+lock_hold (struct lock *lock) {
+   struct thread *curr = thread_current ();
+
+   ASSERT (intr_get_level () == INTR_OFF);
+
+   if (thread_mlfqs)
+      return;
+   lock->max_priority = sema_max_waiter_priority (&lock->semaphore);
+   list_insert_ordered (&curr->held_locks, &lock->elem,
+         cmp_lock_priority, NULL);
+   select_maximum_donation (curr);
+}
+
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
    thread.
@@ -267,9 +415,13 @@ lock_try_acquire (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (!lock_held_by_current_thread (lock));
 
+	enum intr_level old_level = intr_disable ();
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		lock_hold (lock);
+	}
+	intr_set_level (old_level);
 	return success;
 }
 
@@ -285,26 +437,27 @@ lock_release (struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
    
    struct thread *curr = thread_current();
-   struct list_elem *e;
 
    if(!thread_mlfqs){
-   // 릴리즈 된 락을 기다리는 스레드들은 기부해준 스레드 리스트에서 없애준다.
-
-      for(e = list_begin(&curr->donated_threads);
-         e != list_end(&curr->donated_threads);
-         e = list_next(e)){
-         struct thread *tmp = list_entry(e, struct thread, d_elem );
-         if(tmp->wait_lock == lock){
-            list_remove(&tmp->d_elem);
-         }
-      }
+   // 릴리즈 된 락을 기다리는 스레드들의 기부는 락과 함께 사라진다.
+      enum intr_level old_level = intr_disable ();
+      list_remove (&lock->elem);
       select_maximum_donation(curr);
+      intr_set_level (old_level);
    }
    // printf("\n %s %d \n", lock->holder->name, curr->priority );
    lock->holder = NULL;
 	sema_up (&lock->semaphore);
 }
 
+/* Prints adaptive locking statistics. */
+void
+lock_print_stats (void) {
+	if (lock_adaptive)
+		printf ("Locks: %lld contended acquires spun, %lld acquired while spinning\n",
+				spin_count, spin_hits);
+}
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -315,9 +468,10 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's waiter heap. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem h_elem;            /* Heap element. */
+	struct thread *thread;              /* Thread waiting on it. */
 	struct semaphore semaphore;         /* This semaphore. */
 };
 
@@ -328,7 +482,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, sema_elem_priority_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -361,10 +515,13 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-   //list_push_back(&cond->waiters, &waiter.elem);
-   list_insert_ordered (&cond->waiters, &waiter.elem, cmp_sema_priority, NULL);
+   waiter.thread = thread_current ();
+   // 기다리는 동안 우선순위가 바뀌면 조건변수의 waiters 를 다시 정렬하도록 표시
+   waiter.thread->wait_heap = &cond->waiters;
+   heap_push (&cond->waiters, &waiter.h_elem);
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
+   waiter.thread->wait_heap = NULL;
 	lock_acquire (lock);
 
 }
@@ -383,12 +540,9 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-   list_sort(&cond->waiters, cmp_sema_priority, NULL);
-
-	if (!list_empty (&cond->waiters)){
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
-   }
+	if (!heap_empty (&cond->waiters))
+		sema_up (&heap_entry (heap_pop (&cond->waiters),
+					struct semaphore_elem, h_elem)->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -399,54 +553,240 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
    interrupt handler. */
 void
 cond_broadcast (struct condition *cond, struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (lock_held_by_current_thread (lock));
 
-	while (!list_empty (&cond->waiters))
-		cond_signal (cond, lock);
+	/* Make every waiter ready first, then check for preemption
+	   once, instead of possibly yielding after each wakeup. */
+	old_level = intr_disable ();
+	while (!heap_empty (&cond->waiters))
+		sema_wake (&heap_entry (heap_pop (&cond->waiters),
+					struct semaphore_elem, h_elem)->semaphore);
+	thread_preemption ();
+	intr_set_level (old_level);
 }
 
-bool cmp_priority_in_synch (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
+/* Initializes spinlock LOCK as released. */
+void
+spin_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
 
-   ASSERT(a != NULL);
-	ASSERT(b != NULL);
-	struct thread *a_entry = list_entry (a, struct thread, elem);
-	struct thread *b_entry = list_entry (b, struct thread, elem);
+	lock->locked = 0;
+}
 
-	if(a_entry->priority > b_entry->priority) {
-		return true;
-	} else {
-		return false;
-	}
+/* Acquires spinlock LOCK, busy-waiting while another CPU holds it.
+   Interrupts must be off, so that an interrupt handler on this
+   CPU cannot try to take LOCK again. */
+void
+spin_lock (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (lock->locked)
+			asm volatile ("pause");
 }
 
-bool cmp_sema_priority (const struct list_elem *a,const struct list_elem *b, void *aux UNUSED){
+/* Releases spinlock LOCK, which must be held. */
+void
+spin_unlock (struct spinlock *lock) {
+	ASSERT (spin_held (lock));
 
-   ASSERT(a != NULL);
-	ASSERT(b != NULL);
-	struct semaphore_elem *a_entry = list_entry (a, struct semaphore_elem, elem);
-	struct semaphore_elem *b_entry = list_entry (b, struct semaphore_elem, elem);
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+}
 
-   struct thread *a_thread = list_entry(list_begin(&a_entry->semaphore.waiters),struct thread, elem);
-   struct thread *b_thread = list_entry(list_begin(&b_entry->semaphore.waiters),struct thread, elem);
+/* Returns true if LOCK is held by some CPU. */
+bool
+spin_held (const struct spinlock *lock) {
+	ASSERT (lock != NULL);
 
-	if(a_thread->priority > b_thread->priority) {
-		return true;
-	} else {
-		return false;
+	return lock->locked != 0;
+}
+
+/* Initializes RWLOCK.  Any number of readers may hold a
+   readers-writer lock at once, but a writer holds it alone.
+
+   A writer takes WRITE_LOCK as soon as it arrives and keeps it
+   until it releases RWLOCK, while it waits for the active readers
+   to drain and while it writes.  Readers pass through WRITE_LOCK
+   on their way in.  This has two effects.  First, a waiting
+   writer holds off new readers, so writers cannot starve.  Second,
+   every thread queued behind a writer is waiting on an ordinary
+   lock, so it donates its priority to that writer.  A writer
+   waiting for readers does not donate to them, because there may
+   be any number of them.
+
+   WRITER records under LOCK that a writer has taken WRITE_LOCK for
+   good, which is what rw_upgrade() needs to know; a reader passing
+   through WRITE_LOCK never sets it.  UPGRADING makes a writer that
+   grabbed WRITE_LOCK ahead of an upgrading reader hand it back. */
+void
+rw_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_init (&rw->write_lock);
+	lock_init (&rw->lock);
+	cond_init (&rw->no_readers);
+	cond_init (&rw->upgraded);
+	rw->readers = 0;
+	rw->writer = false;
+	rw->upgrading = false;
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or is
+   waiting for it. */
+void
+rw_read_acquire (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+	ASSERT (!rw_write_held_by_current_thread (rw));
+
+	lock_acquire (&rw->write_lock);
+	lock_acquire (&rw->lock);
+	rw->readers++;
+	lock_release (&rw->lock);
+	lock_release (&rw->write_lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rw_read_release (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->readers > 0);
+	if (--rw->readers == 0)
+		cond_signal (&rw->no_readers, &rw->lock);
+	lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds it
+   in either mode. */
+void
+rw_write_acquire (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	for (;;) {
+		lock_acquire (&rw->write_lock);
+		lock_acquire (&rw->lock);
+		if (!rw->upgrading)
+			break;
+
+		/* A reader is upgrading and will wait for WRITE_LOCK, which
+		   we must not hold while we wait for that reader to leave. */
+		lock_release (&rw->write_lock);
+		while (rw->upgrading)
+			cond_wait (&rw->upgraded, &rw->lock);
+		lock_release (&rw->lock);
 	}
+	rw->writer = true;
+	while (rw->readers > 0)
+		cond_wait (&rw->no_readers, &rw->lock);
+	lock_release (&rw->lock);
 }
 
-bool cmp_priority_in_donate (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
+/* Releases RW, which the current thread holds for writing. */
+void
+rw_write_release (struct rwlock *rw) {
+	ASSERT (rw_write_held_by_current_thread (rw));
 
-   ASSERT(a != NULL);
-	ASSERT(b != NULL);
-	struct thread *a_entry = list_entry (a, struct thread, d_elem);
-	struct thread *b_entry = list_entry (b, struct thread, d_elem);
+	lock_acquire (&rw->lock);
+	rw->writer = false;
+	lock_release (&rw->lock);
+	lock_release (&rw->write_lock);
+}
 
-	if(a_entry->priority > b_entry->priority) {
-		return true;
-	} else {
+/* Converts the current thread's read hold on RW into a write hold.
+   Fails and returns false, still holding RW for reading, if a
+   writer is already waiting or another reader is already
+   upgrading: either one waits for this reader to leave, so the
+   caller must release RW and start over.  Otherwise waits for
+   the other readers to leave and returns true. */
+bool
+rw_upgrade (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	lock_acquire (&rw->lock);
+	ASSERT (rw->readers > 0);
+	if (rw->writer || rw->upgrading) {
+		lock_release (&rw->lock);
 		return false;
 	}
-}
\ No newline at end of file
+	rw->upgrading = true;
+	lock_release (&rw->lock);
+
+	/* Only a reader passing through, or a writer about to back off,
+	   can hold WRITE_LOCK now. */
+	lock_acquire (&rw->write_lock);
+
+	lock_acquire (&rw->lock);
+	rw->readers--;
+	rw->writer = true;
+	rw->upgrading = false;
+	cond_broadcast (&rw->upgraded, &rw->lock);
+	while (rw->readers > 0)
+		cond_wait (&rw->no_readers, &rw->lock);
+	lock_release (&rw->lock);
+	return true;
+}
+
+/* Converts the current thread's write hold on RW into a read hold,
+   letting waiting readers in without a window for other
+   writers. */
+void
+rw_downgrade (struct rwlock *rw) {
+	ASSERT (rw_write_held_by_current_thread (rw));
+
+	lock_acquire (&rw->lock);
+	rw->readers++;
+	rw->writer = false;
+	lock_release (&rw->lock);
+	lock_release (&rw->write_lock);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rw_write_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return lock_held_by_current_thread (&rw->write_lock);
+}
+
+/* Orders semaphore waiters by their current priority. */
+static bool
+waiter_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct thread, h_elem)->priority
+		< heap_entry (b, struct thread, h_elem)->priority;
+}
+
+/* Orders condition variable waiters by the current priority of the
+   thread waiting on each semaphore. */
+static bool
+sema_elem_priority_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct semaphore_elem, h_elem)->thread->priority
+		< heap_entry (b, struct semaphore_elem, h_elem)->thread->priority;
+}
+
+/* Returns the highest priority among the threads waiting on
+   SEMA, or PRI_MIN - 1 if there are none. */
+static int
+sema_max_waiter_priority (struct semaphore *sema) {
+	if (heap_empty (&sema->waiters))
+		return PRI_MIN - 1;
+	return heap_entry (heap_top (&sema->waiters),
+			struct thread, h_elem)->priority;
+}
+
+/* Orders held locks by the highest priority waiting on them. */
+static bool
+cmp_lock_priority (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct lock, elem)->max_priority
+		> list_entry (b, struct lock, elem)->max_priority;
+}
@@ -2,15 +2,24 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "threads/fixedpoint.h"
+#include "devices/timer.h"
 
 #include "intrinsic.h"
 
@@ -28,39 +37,67 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Threads in THREAD_READY state, that is, ready to run but not
+   actually running, wait in the run queue of some CPU; see
+   struct runqueue in cpu.h.  A thread's `cpu' member names the CPU
+   whose queue it is on, or last ran on. */
+
+/* List of all live threads.  Threads are added by init_thread()
+   and removed by thread_exit(). */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
+/* MLFQS: threads whose recent_cpu grew since their priority was
+   last computed. */
+static struct list dirty_list;
+
+/* MLFQS system load average. */
+fixedpoint load_avg;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
+/* Lock used by allocate_tid() and tid_table. */
 static struct lock tid_lock;
 
+/* Records of live threads created by thread_create(), by tid. */
+static struct hash tid_table;
+
+/* Cache of struct child_info. */
+static struct kmem_cache *child_info_cache;
+
 /* Thread destruction requests */
 static struct list destruction_req;
 
-// blocked thread list 
-static struct list sleep_list;
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
-
+/* Pages of dead threads kept for reuse, most recently freed first,
+   so that thread_create() need not go to the page allocator.
+   init_thread() resets struct thread itself, so the rest of a
+   recycled page is not zeroed again.  Interrupts must be off to
+   touch the cache. */
+#define THREAD_CACHE_MAX 32     /* Max # of cached pages. */
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
+/* Sleeping threads, hashed into a timing wheel by the tick they
+   are due to wake up on.  Each slot is kept sorted by awake_ticks,
+   and next_wakeup_tick caches the earliest deadline of all
+   sleepers so that thread_wakeup() returns immediately on ticks
+   when nobody is due. */
+#define SLEEP_WHEEL_SIZE 64     /* # of slots, one tick each. */
+static struct list sleep_wheel[SLEEP_WHEEL_SIZE];
+static int64_t wheel_tick;      /* Last tick processed by the wheel. */
+static int64_t next_wakeup_tick = INT64_MAX;
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
+#define EDF_UTIL_MAX 900        /* Per-mille of a CPU deadline threads may reserve. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, thread_launch() always takes the iretq path below. */
+bool thread_slow_switch;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -69,6 +106,36 @@ static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
 static tid_t allocate_tid (void);
+static struct thread *thread_page_alloc (void);
+static tid_t do_thread_create (const char *name, int priority,
+		thread_func *, void *aux, bool waitable);
+static bool register_child (struct thread *parent, struct thread *child,
+		bool waitable);
+static void unregister_thread (struct thread *);
+static void child_info_put (struct child_info *);
+static void child_orphan (struct hash_elem *, void *aux);
+static hash_hash_func child_hash;
+static hash_less_func child_less;
+static hash_hash_func tid_hash;
+static hash_less_func tid_less;
+static void thread_page_free (struct thread *);
+static void ready_queue_push (struct thread *);
+static bool cmp_awake_ticks (const struct list_elem *,
+		const struct list_elem *, void *aux);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (struct runqueue *);
+static void runqueue_unlink (struct runqueue *, struct thread *);
+static bool cpu_allowed (const struct thread *, const struct cpu *);
+static void affinity_place (struct thread *);
+static int ready_threads_cnt (void);
+static bool is_idle (const struct thread *);
+static bool is_edf (const struct thread *);
+static bool ready_outranks (struct thread *);
+static int dl_util (const struct thread *);
+static void dl_replenish (struct thread *, int64_t now);
+static bool cmp_deadline (const struct list_elem *,
+		const struct list_elem *, void *aux);
+static void sleep_wheel_insert (struct thread *, int64_t wake);
 bool cmp_priority (const struct list_elem *a,const struct list_elem *b, void *aux);
 
 #define f 16384
@@ -165,10 +232,13 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	cpu_init ();
 	list_init (&destruction_req);
-	list_init (&sleep_list);
+	list_init (&thread_cache);
+	for (int i = 0; i < SLEEP_WHEEL_SIZE; i++)
+		list_init (&sleep_wheel[i]);
 	list_init (&all_list);
+	list_init (&dirty_list);
 
 	if(thread_mlfqs){
 		load_avg = 0;
@@ -177,6 +247,8 @@ thread_init (void) {
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
+	initial_thread->cpu = &cpus[0];
+	cpus[0].curr = initial_thread;
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
 }
@@ -187,42 +259,89 @@ void
 thread_start (void) {
 	/* Create the idle thread. */
 	struct semaphore idle_started;
+
+	/* Needs malloc(), so it cannot be done in thread_init(). */
+	if (!hash_init (&tid_table, tid_hash, tid_less, NULL))
+		PANIC ("thread_start: out of memory for the tid table");
+	child_info_cache = kmem_cache_create ("child_info",
+			sizeof (struct child_info), 0, NULL);
+	if (child_info_cache == NULL)
+		PANIC ("thread_start: out of memory for child records");
+
 	sema_init (&idle_started, 0);
 	thread_create ("idle", PRI_MIN, idle, &idle_started);
 
 	/* Start preemptive thread scheduling. */
 	intr_enable ();
 
-	/* Wait for the idle thread to initialize idle_thread. */
+	/* Wait for the idle thread to register itself with this CPU. */
 	sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
+/* Called by the timer interrupt handler at each timer tick, with
+   the frame of the code it interrupted in IF_.
    Thus, this function runs in an external interrupt context. */
 void
-thread_tick (void) {
+thread_tick (struct intr_frame *if_) {
 	struct thread *t = thread_current ();
+	struct cpu *c = this_cpu ();
+
+	/* Update statistics.  A process's time in system calls and page
+	   faults is kernel time; only ticks that interrupt user mode
+	   count as user time. */
+	if (t == c->idle)
+		c->idle_ticks++;
+	else if ((if_->cs & 3) == 3) {
+		c->user_ticks++;
+		t->user_ticks++;
+	}
+	else {
+		c->kernel_ticks++;
+		t->kernel_ticks++;
+	}
 
-	/* Update statistics. */
-	if (t == idle_thread)
-		idle_ticks++;
-#ifdef USERPROG
-	else if (t->pml4 != NULL)
-		user_ticks++;
-#endif
-	else
-		kernel_ticks++;
+	/* Charge a deadline thread's budget.  Once it is spent, the
+	   thread is throttled until its period ends; see thread_yield(). */
+	if (is_edf (t)) {
+		int64_t now = timer_ticks ();
+
+		if (now >= t->dl_deadline)
+			dl_replenish (t, now);
+		if (--t->dl_budget <= 0) {
+			t->dl_throttled = true;
+			intr_yield_on_return ();
+		}
+	}
 
 	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE)
+	if (++c->thread_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
+/* Charges TICKS timer ticks that passed without a timer interrupt
+   to the idle thread.  See timer_idle_enter(). */
+void
+thread_idle_ticks (int64_t ticks) {
+	this_cpu ()->idle_ticks += ticks;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
+	long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+	int i;
+
+	for (i = 0; i < cpu_cnt; i++) {
+		idle_ticks += cpus[i].idle_ticks;
+		kernel_ticks += cpus[i].kernel_ticks;
+		user_ticks += cpus[i].user_ticks;
+	}
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	for (i = 0; i < cpu_cnt; i++)
+		if (cpu_cnt > 1 || cpus[i].affinity_violations > 0)
+			printf ("CPU %d: %lld migrations, %lld affinity violations\n",
+					i, cpus[i].migrations, cpus[i].affinity_violations);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -243,20 +362,46 @@ thread_print_stats (void) {
 tid_t
 thread_create (const char *name, int priority,
 		thread_func *function, void *aux) {
+	return do_thread_create (name, priority, function, aux, false);
+}
 
+/* Like thread_create(), but also files the new thread among the
+   caller's children, so that the caller can find it with
+   find_child_for_tid() and collect its exit status.  The record
+   stays until the caller releases it with release_child() or
+   exits, so use this only for children that will be waited for,
+   such as user processes. */
+tid_t
+thread_create_child (const char *name, int priority,
+		thread_func *function, void *aux) {
+	return do_thread_create (name, priority, function, aux, true);
+}
+
+/* Does the work of thread_create() and thread_create_child(). */
+static tid_t
+do_thread_create (const char *name, int priority,
+		thread_func *function, void *aux, bool waitable) {
 	struct thread *t;
 	tid_t tid;
 
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL)
 		return TID_ERROR;
 
 	/* Initialize thread. */
 	init_thread (t, name, priority);
+	t->affinity = thread_current ()->affinity;
 	tid = t->tid = allocate_tid ();
+	if (!register_child (thread_current (), t, waitable)) {
+		enum intr_level old_level = intr_disable ();
+		list_remove (&t->a_elem);
+		thread_page_free (t);
+		intr_set_level (old_level);
+		return TID_ERROR;
+	}
 
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
@@ -270,7 +415,6 @@ thread_create (const char *name, int priority,
 	t->tf.eflags = FLAG_IF;
 
 	//강철구
-	list_push_back(&thread_current()->child_list, &t->c_elem);
 	t->parent = thread_current();
 
 	thread_unblock(t);
@@ -281,13 +425,8 @@ thread_create (const char *name, int priority,
 
 void
 thread_preemption(){
-	if(!list_empty(&ready_list) && !intr_context()){
-		struct thread *a = thread_current();
-		struct list_elem *b_elem = list_begin(&ready_list);
-		struct thread *b = list_entry (b_elem, struct thread, elem);
-
-		if(a->priority < b->priority) thread_yield();
-	}
+	if(!intr_context() && ready_outranks (thread_current ()))
+		thread_yield();
 }
 
 
@@ -296,7 +435,7 @@ thread_preemption(){
 	슬립 리스트에 넣고
 	깨어날 시간을 알아야 한다.  */
 void
-thread_sleep (int sleep_ticks) {
+thread_sleep (int64_t sleep_ticks) {
 	struct thread *curr = thread_current();
 	enum intr_level old_level;
 	// 받은 매개변수 sleep_ticks와 전체 timer_tick 가 같을 때 깨워야 한다.
@@ -306,35 +445,82 @@ thread_sleep (int sleep_ticks) {
 	old_level = intr_disable ();
 	// 현재 스레드의 상태를 블락으로 바꾼다
 
-	// 슬립리스트에 넣는다 list_push_back을 사용하면 될것같다.
-	if (curr != idle_thread) {
-		curr->awake_ticks = sleep_ticks;
-		list_push_back (&sleep_list, &curr->elem);
+	// 깨어날 틱의 슬롯에 넣는다. 이미 지난 틱이면 다음 틱의 슬롯에 넣는다.
+	if (!is_idle (curr)) {
+		sleep_wheel_insert (curr, sleep_ticks);
 		thread_block();
 	}
 
 	intr_set_level (old_level);
 }
+
+/* Files T, which is about to block, in the sleep wheel to be woken
+   at tick WAKE, or at the next tick if WAKE has passed.  Interrupts
+   must be off. */
+static void
+sleep_wheel_insert (struct thread *t, int64_t wake) {
+	int64_t slot_tick = wake > wheel_tick ? wake : wheel_tick + 1;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	t->awake_ticks = wake;
+	list_insert_ordered (&sleep_wheel[slot_tick % SLEEP_WHEEL_SIZE],
+			&t->elem, cmp_awake_ticks, NULL);
+	if (wake < next_wakeup_tick)
+		next_wakeup_tick = wake;
+}
+
 /*
-	sleep_list 에 있는 쓰레드들 중에 awake ticks 가 total ticks 보다 작은 경우 깨운다.
+	awake ticks 가 total ticks 보다 작거나 같은 쓰레드들을 깨운다.
+
+	Called on every timer tick.  Returns without touching the wheel
+	unless a sleeper is due; otherwise visits only the slots of the
+	ticks elapsed since the last call (at most SLEEP_WHEEL_SIZE),
+	then recomputes next_wakeup_tick from the slot heads.
 */
-void thread_wakeup(int total_ticks) {
+void thread_wakeup(int64_t total_ticks) {
 
 	enum intr_level old_level;
-	struct list_elem *ptr = list_begin(&sleep_list);
-	struct thread *waken;
+	int64_t t, first;
 	// 이 동작중 인터럽트를 막는다.
 	old_level = intr_disable ();	
 
-	while(ptr != list_end (&sleep_list)){
-		waken = list_entry (ptr, struct thread, elem);
-		if (waken->awake_ticks <= total_ticks) {
-			ptr = list_remove(&waken->elem);
-			thread_unblock(waken);
-		} else {
-			ptr = list_next(&waken->elem);	
+	if (total_ticks < next_wakeup_tick) {
+		wheel_tick = total_ticks;
+		intr_set_level (old_level);
+		return;
+	}
+
+	first = wheel_tick + 1;
+	if (total_ticks - first >= SLEEP_WHEEL_SIZE)
+		first = total_ticks - SLEEP_WHEEL_SIZE + 1;
+	for (t = first; t <= total_ticks; t++) {
+		struct list *slot = &sleep_wheel[t % SLEEP_WHEEL_SIZE];
+
+		while (!list_empty (slot)) {
+			struct thread *waken = list_entry (list_front (slot),
+					struct thread, elem);
+			if (waken->awake_ticks > total_ticks)
+				break;
+			list_pop_front (slot);
+			thread_unblock (waken);
 		}
 	}
+	wheel_tick = total_ticks;
+
+	next_wakeup_tick = INT64_MAX;
+	for (int i = 0; i < SLEEP_WHEEL_SIZE; i++)
+		if (!list_empty (&sleep_wheel[i])) {
+			struct thread *head = list_entry (list_front (&sleep_wheel[i]),
+					struct thread, elem);
+			if (head->awake_ticks < next_wakeup_tick)
+				next_wakeup_tick = head->awake_ticks;
+		}
+
+	/* A woken deadline or higher-priority thread should not wait
+	   for the current time slice to run out. */
+	if (intr_context () && ready_outranks (thread_current ()))
+		intr_yield_on_return ();
 	intr_set_level (old_level);	
 }
 
@@ -348,6 +534,7 @@ void
 thread_block (void) {
 	ASSERT (!intr_context ());
 	ASSERT (intr_get_level () == INTR_OFF);
+	trace_event (TRACE_BLOCK, thread_current ()->tid, 0);
 	thread_current ()->status = THREAD_BLOCKED;
 	schedule ();
 }
@@ -367,10 +554,17 @@ thread_unblock (struct thread *t) {
 	ASSERT (is_thread (t));
 	
 	old_level = intr_disable ();
-	ASSERT (t->status = THREAD_BLOCKED);
-	// list_push_back (&ready_list, &t->elem)
-	list_insert_ordered(&ready_list, &t->elem, cmp_priority , NULL);
+	ASSERT (t->status == THREAD_BLOCKED);
+	if (is_edf (t)) {
+		int64_t now = timer_ticks ();
+
+		if (t->dl_throttled || now >= t->dl_deadline)
+			dl_replenish (t, now);
+	}
 	t->status = THREAD_READY;
+	affinity_place (t);
+	ready_queue_push (t);
+	trace_event (TRACE_UNBLOCK, t->tid, 0);
 	intr_set_level (old_level);
 }
 
@@ -413,10 +607,15 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
+	unregister_thread (thread_current ());
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	list_remove (&thread_current ()->a_elem);
+	if (thread_current ()->recent_cpu_dirty)
+		list_remove (&thread_current ()->dirty_elem);
+	thread_current ()->cpu->dl_util -= dl_util (thread_current ());
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -432,9 +631,15 @@ thread_yield (void) {
 
 	old_level = intr_disable ();
 
-	if (curr != idle_thread)
-		list_insert_ordered (&ready_list, &curr->elem, cmp_priority, NULL); 
-	do_schedule(THREAD_READY);
+	// 예산을 다 쓴 deadline 스레드는 다음 주기까지 재운다
+	if (curr->dl_throttled) {
+		sleep_wheel_insert (curr, curr->dl_deadline);
+		do_schedule (THREAD_BLOCKED);
+	} else {
+		if (!is_idle (curr))
+			ready_queue_push (curr);
+		do_schedule (THREAD_READY);
+	}
 
 	intr_set_level (old_level);
 
@@ -452,21 +657,234 @@ thread_set_priority (int new_priority) {
 	}
 }
 
+/* Recomputes CURR's effective priority: its own priority or the
+   highest priority waiting on any lock it holds, whichever is
+   greater.  held_locks is kept sorted, so that is its front. */
 void select_maximum_donation(struct thread *curr) {
+	int priority = curr->origin_priority;
+	enum intr_level old_level = intr_disable ();
 
-	curr->priority = curr->origin_priority;
+	if(!list_empty(&curr->held_locks)) {
+		struct lock *top = list_entry (list_front (&curr->held_locks),
+				struct lock, elem);
 
-	if(!list_empty(&curr->donated_threads)) {
+		if (top->max_priority > priority) priority = top->max_priority;
+	}
+	thread_change_priority (curr, priority);
+	intr_set_level (old_level);
+}
 
-		struct thread *tmp = list_entry(
-			list_max(&curr->donated_threads,cmp_priority_in_donate,NULL), 
-				struct thread, d_elem);
+/* Sets T's effective priority to PRIORITY.  If T is sitting in
+   the run queue it is moved to the queue for its new priority;
+   no other ready thread is touched.  If T is waiting on a
+   semaphore or condition variable, that waiter heap is marked for
+   reordering. */
+void
+thread_change_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
 
-		if (tmp->priority > curr->priority) curr->priority = tmp->priority;
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
 
-		list_sort(&ready_list, cmp_priority, NULL);
-   	}
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && t->priority != priority) {
+		ready_queue_remove (t);
+		t->priority = priority;
+		ready_queue_push (t);
+	} else if (t->wait_heap != NULL && t->priority != priority) {
+		t->priority = priority;
+		heap_invalidate (t->wait_heap);
+	} else
+		t->priority = priority;
+	intr_set_level (old_level);
 }
+/* Moves the current thread into the deadline class: it is promised
+   RUNTIME timer ticks of CPU time in every PERIOD ticks, and is
+   throttled once it has used them up.  Deadline threads run before
+   all priority threads (and MLFQS threads), earliest deadline
+   first.  Returns false, changing nothing, if the CPU's deadline
+   threads would then reserve more than EDF_UTIL_MAX per mille of
+   it.  A RUNTIME of 0 returns the thread to its normal class. */
+bool
+thread_set_deadline (int64_t runtime, int64_t period) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+	int util;
+	bool ok;
+
+	ASSERT (runtime == 0 || (0 < runtime && runtime <= period));
+
+	old_level = intr_disable ();
+	util = curr->cpu->dl_util - dl_util (curr);
+	if (runtime > 0)
+		util += DIV_ROUND_UP (runtime * 1000, period);
+	ok = util <= EDF_UTIL_MAX;
+	if (ok) {
+		curr->cpu->dl_util = util;
+		curr->dl_runtime = runtime;
+		curr->dl_period = runtime > 0 ? period : 0;
+		curr->dl_throttled = false;
+		if (runtime > 0)
+			dl_replenish (curr, timer_ticks ());
+	}
+	intr_set_level (old_level);
+
+	/* Leaving the class may let others run first. */
+	if (ok)
+		thread_preemption ();
+	return ok;
+}
+
+/* Restricts thread TID to the CPUs in MASK, where bit I stands
+   for cpus[I].  A queued thread moves to an allowed CPU at once;
+   the running thread gets off a CPU it may no longer use by
+   sleeping for a tick, so that its wakeup places it.  Returns
+   false, changing nothing, if there is no such thread or MASK
+   names a CPU beyond CPU_MAX or no online CPU at all. */
+bool
+thread_set_affinity (tid_t tid, unsigned mask) {
+	struct thread *curr = thread_current ();
+	struct child_info key;
+	struct hash_elem *e;
+	struct thread *t = NULL;
+	bool move = false;
+	int i;
+
+	if ((mask & ~CPU_MASK_ALL) != 0)
+		return false;
+	for (i = 0; i < cpu_cnt; i++)
+		if (cpus[i].online && (mask & (1u << i)))
+			break;
+	if (i == cpu_cnt)
+		return false;
+
+	/* Holding tid_lock keeps T from exiting under us. */
+	key.tid = tid;
+	lock_acquire (&tid_lock);
+	e = hash_find (&tid_table, &key.tid_elem);
+	if (e != NULL)
+		t = hash_entry (e, struct child_info, tid_elem)->thread;
+	if (t != NULL) {
+		enum intr_level old_level = intr_disable ();
+
+		t->affinity = mask;
+		if (t->status == THREAD_READY) {
+			ready_queue_remove (t);
+			affinity_place (t);
+			ready_queue_push (t);
+		} else if (t == curr && !cpu_allowed (t, t->cpu))
+			for (i = 0; i < cpu_cnt; i++)
+				if (cpus[i].online && cpu_allowed (t, &cpus[i]))
+					move = true;
+		intr_set_level (old_level);
+	}
+	lock_release (&tid_lock);
+
+	if (move)
+		thread_sleep (timer_ticks () + 1);
+	return t != NULL;
+}
+
+/* Stores the affinity mask of thread TID in *MASK.  Returns false
+   if there is no such thread. */
+bool
+thread_get_affinity (tid_t tid, unsigned *mask) {
+	struct child_info key;
+	struct hash_elem *e;
+	struct thread *t = NULL;
+
+	key.tid = tid;
+	lock_acquire (&tid_lock);
+	e = hash_find (&tid_table, &key.tid_elem);
+	if (e != NULL)
+		t = hash_entry (e, struct child_info, tid_elem)->thread;
+	if (t != NULL)
+		*mask = t->affinity;
+	lock_release (&tid_lock);
+	return t != NULL;
+}
+
+/* Returns true if T's affinity mask allows it to run on C. */
+static bool
+cpu_allowed (const struct thread *t, const struct cpu *c) {
+	return (t->affinity & (1u << c->id)) != 0;
+}
+
+/* Points T, which is about to be queued, at a CPU it may run on:
+   its own if allowed, otherwise the allowed online CPU with the
+   fewest ready threads.  A deadline thread takes its reservation
+   along; admission is not checked again.  If no allowed CPU is
+   online, T stays and the violation is counted.  Interrupts must
+   be off. */
+static void
+affinity_place (struct thread *t) {
+	struct cpu *best = NULL;
+	int i;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->cpu->online && cpu_allowed (t, t->cpu))
+		return;
+	for (i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c->online && cpu_allowed (t, c)
+				&& (best == NULL || c->rq.cnt < best->rq.cnt))
+			best = c;
+	}
+	if (best == NULL) {
+		t->cpu->affinity_violations++;
+		return;
+	}
+	t->cpu->dl_util -= dl_util (t);
+	best->dl_util += dl_util (t);
+	t->cpu = best;
+}
+
+/* Returns the per-mille of its CPU reserved by T. */
+static int
+dl_util (const struct thread *t) {
+	return is_edf (t) ? DIV_ROUND_UP (t->dl_runtime * 1000, t->dl_period) : 0;
+}
+
+/* Starts a new period for deadline thread T at tick NOW, with a
+   full budget. */
+static void
+dl_replenish (struct thread *t, int64_t now) {
+	t->dl_deadline = now + t->dl_period;
+	t->dl_budget = t->dl_runtime;
+	t->dl_throttled = false;
+}
+
+/* Copies the statistics of live thread TID into *ST.  Returns false
+   if there is no such thread. */
+bool
+thread_get_stat (tid_t tid, struct proc_stat *st) {
+	struct child_info key;
+	struct hash_elem *e;
+	struct thread *t = NULL;
+
+	/* Holding tid_lock keeps T from exiting under us. */
+	key.tid = tid;
+	lock_acquire (&tid_lock);
+	e = hash_find (&tid_table, &key.tid_elem);
+	if (e != NULL)
+		t = hash_entry (e, struct child_info, tid_elem)->thread;
+	if (t != NULL) {
+		st->pid = t->tid;
+		strlcpy (st->name, t->name, sizeof st->name);
+		st->priority = t->priority;
+		st->user_ticks = t->user_ticks;
+		st->kernel_ticks = t->kernel_ticks;
+		st->voluntary_switches = t->nvcsw;
+		st->involuntary_switches = t->nivcsw;
+		st->lock_wait_ticks = t->lock_wait_ticks;
+		st->page_faults = t->page_faults;
+	}
+	lock_release (&tid_lock);
+	return t != NULL;
+}
+
 /* Returns the current thread's priority. */
 // 현재 스레드의 우선순위를 반환합니다. 
 // 우선 순위 기부가 있는 경우 더 높은 기부된) 우선순위를 반환합니다.
@@ -497,14 +915,12 @@ thread_get_nice (void) {
 }
 
 fixedpoint calculate_ad_avg() {
-	int ready_threads;
+	int ready_threads = ready_threads_cnt ();
 
-	if (thread_current() != idle_thread){
-		ready_threads = list_size(&ready_list)+1;
-
-	} else {
-		ready_threads = list_size(&ready_list);
-	}
+	// 각 CPU 에서 돌고 있는 (idle 이 아닌) 스레드도 센다
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpus[i].online && !is_idle (cpus[i].curr))
+			ready_threads++;
 
 	fixedpoint p1 = fp_divide_complex(fp_multiply_complex(load_avg, 59),60);
 	fixedpoint p2 = fp_divide_complex(convert_itof(ready_threads),60);
@@ -537,35 +953,38 @@ thread_get_recent_cpu (void) {
 	return convert_ftoi_rounding(result);
 }
 
-void increase_recent_cpu_point() {
-
-	if(thread_current() != idle_thread){
-		thread_current()->recent_cpu_point = fp_add_complex(thread_current()->recent_cpu_point,1);
-	}
-}
-
-void refresh_all_thread_recent_cpu () {
-	struct list_elem *ptr = list_begin(&ready_list);
+void increase_recent_cpu_point(void) {
+	struct thread *curr = thread_current();
 
-	thread_current()->recent_cpu_point = calculate_recent_cpu(thread_current());
+	if(!is_idle (curr)){
+		curr->recent_cpu_point = fp_add_complex(curr->recent_cpu_point,1);
 
-	while(ptr != list_end(&ready_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, elem);
-		if(curr != idle_thread) {
-			curr->recent_cpu_point = calculate_recent_cpu(curr);
+		/* Its priority is now stale; refresh it on the next
+		   fourth tick. */
+		if (!curr->recent_cpu_dirty) {
+			curr->recent_cpu_dirty = true;
+			list_push_back (&dirty_list, &curr->dirty_elem);
 		}
-		ptr = list_next(ptr);
 	}
+}
 
-	ptr = list_begin(&sleep_list);
+/* Once per second: decays recent_cpu of every thread and
+   recomputes every priority in the same pass. */
+void refresh_all_thread_recent_cpu (void) {
+	struct list_elem *ptr;
 
-	while(ptr != list_end(&sleep_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, elem);
-		if(curr != idle_thread) {
+	for (ptr = list_begin (&all_list); ptr != list_end (&all_list);
+			ptr = list_next (ptr)) {
+		struct thread *curr = list_entry(ptr, struct thread, a_elem);
+		if(!is_idle (curr)) {
 			curr->recent_cpu_point = calculate_recent_cpu(curr);
+			thread_change_priority (curr, calculate_priority(curr));
 		}
-		ptr = list_next(ptr);
 	}
+
+	while (!list_empty (&dirty_list))
+		list_entry (list_pop_front (&dirty_list), struct thread,
+				dirty_elem)->recent_cpu_dirty = false;
 }
 
 fixedpoint calculate_recent_cpu(struct thread *curr) {
@@ -580,27 +999,15 @@ fixedpoint calculate_recent_cpu(struct thread *curr) {
 	return result;
 }
 
-void refresh_all_thread_priority () {
-	struct list_elem *ptr = list_begin(&ready_list);
-
-	thread_current()->priority = calculate_priority(thread_current());
-
-	while(ptr != list_end(&ready_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, elem);
-		if(curr != idle_thread) {
-			curr->priority = calculate_priority(curr);
-		}
-		ptr = list_next(ptr);
-	}
-	
-	ptr = list_begin(&sleep_list);
-
-	while(ptr != list_end(&sleep_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, elem);
-		if(curr != idle_thread) {
-			curr->priority = calculate_priority(curr);
-		}
-		ptr = list_next(ptr);
+/* Every fourth tick: load_avg and nice values have not changed
+   since the last refresh, so only the threads that ran (and thus
+   gained recent_cpu) need a new priority. */
+void refresh_all_thread_priority (void) {
+	while (!list_empty (&dirty_list)) {
+		struct thread *curr = list_entry (list_pop_front (&dirty_list),
+				struct thread, dirty_elem);
+		curr->recent_cpu_dirty = false;
+		thread_change_priority (curr, calculate_priority(curr));
 	}
 }
 
@@ -614,14 +1021,19 @@ int calculate_priority(struct thread *curr){
 	fixedpoint f_result = f_PRI_MAX - fp_divide_complex(f_recent_cpu,4)
 								 - fp_multiply_complex(f_nice,2);
 
-	return convert_ftoi_rounding(f_result);
+	int priority = convert_ftoi_rounding(f_result);
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	return priority;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
 
    The idle thread is initially put on the ready list by
    thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
+   point it registers itself as its CPU's idle thread, "up"s the semaphore passed
    to it to enable thread_start() to continue, and immediately
    blocks.  After that, the idle thread never appears in the
    ready list.  It is returned by next_thread_to_run() as a
@@ -630,14 +1042,25 @@ static void
 idle (void *idle_started_ UNUSED) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	this_cpu ()->idle = thread_current ();
+	intr_set_level (old_level);
 	sema_up (idle_started);
 
 	for (;;) {
+		int64_t deadline;
+
 		/* Let someone else run. */
 		intr_disable ();
 		thread_block ();
 
+		/* Nothing else is runnable, so there is no point in taking
+		   a timer interrupt before the next sleeper or delayed work
+		   is due. */
+		deadline = workqueue_next_expiry ();
+		timer_idle_enter (next_wakeup_tick < deadline
+				? next_wakeup_tick : deadline);
+
 		/* Re-enable interrupts and wait for the next one.
 
 		   The `sti' instruction disables interrupts until the
@@ -651,6 +1074,7 @@ idle (void *idle_started_ UNUSED) {
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
 		   7.11.1 "HLT Instruction". */
 		asm volatile ("sti; hlt" : : : "memory");
+		timer_idle_exit ();
 	}
 }
 
@@ -678,11 +1102,13 @@ init_thread (struct thread *t, const char *name, int priority) {
 	strlcpy (t->name, name, sizeof t->name);
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
+	t->cpu = running_thread ()->cpu;
+	t->affinity = CPU_MASK_ALL;
 	t->magic = THREAD_MAGIC;
 
 	// additonal values
 	t->origin_priority = priority;
-	list_init(&t->donated_threads);
+	list_init(&t->held_locks);
 
 	// advanced scheduler
 	t->nice_point = 0;
@@ -695,11 +1121,9 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->parent = NULL;
 	t->current_file = NULL;
 	
-	sema_init(&t->fork_sema,0);
-	sema_init(&t->wait_sema,0);
-	sema_init(&t->exit_sema,0);
+	t->child_info = NULL;
+	t->has_children = false;
 
-	list_init(&t->child_list);
 	list_init(&t->file_list);
 
 	// lock_init(&t->child_lock);
@@ -713,16 +1137,139 @@ init_thread (struct thread *t, const char *name, int priority) {
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
+   return a thread from this CPU's run queue, unless the run queue
+   is empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   this CPU's idle thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
+	struct cpu *c = this_cpu ();
+	struct thread *t = ready_queue_pop (&c->rq);
+
+	return t != NULL ? t : c->idle;
+}
+
+/* Appends T to the tail of the queue for its priority in the run
+   queue of T's CPU, or files it by deadline if T is in the deadline
+   class.  Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t) {
+	struct runqueue *rq = &t->cpu->rq;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	spin_lock (&rq->lock);
+	if (is_edf (t))
+		list_insert_ordered (&rq->edf, &t->elem, cmp_deadline, NULL);
+	else {
+		list_push_back (&rq->queues[t->priority], &t->elem);
+		rq->bitmap |= 1ULL << t->priority;
+	}
+	rq->cnt++;
+	spin_unlock (&rq->lock);
+}
+
+/* Removes T, which must be in its CPU's run queue at its current
+   priority.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t) {
+	struct runqueue *rq = &t->cpu->rq;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&rq->lock);
+	runqueue_unlink (rq, t);
+	spin_unlock (&rq->lock);
+}
+
+/* Removes and returns the highest-priority thread in RQ, or a null
+   pointer if RQ is empty.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (struct runqueue *rq) {
+	struct thread *t = NULL;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	spin_lock (&rq->lock);
+	if (!list_empty (&rq->edf)) {
+		t = list_entry (list_front (&rq->edf), struct thread, elem);
+		runqueue_unlink (rq, t);
+	} else if (rq->bitmap != 0) {
+		int top = 63 - __builtin_clzll (rq->bitmap);
+
+		t = list_entry (list_front (&rq->queues[top]), struct thread, elem);
+		runqueue_unlink (rq, t);
+	}
+	spin_unlock (&rq->lock);
+	return t;
+}
+
+/* Unlinks T from RQ, whose lock must be held. */
+static void
+runqueue_unlink (struct runqueue *rq, struct thread *t) {
+	ASSERT (spin_held (&rq->lock));
+
+	list_remove (&t->elem);
+	if (!is_edf (t) && list_empty (&rq->queues[t->priority]))
+		rq->bitmap &= ~(1ULL << t->priority);
+	rq->cnt--;
+}
+
+/* Returns true if this CPU's run queue holds a thread that should
+   run before CURR.  Deadline threads come before all others, and
+   the earlier deadline first among them. */
+static bool
+ready_outranks (struct thread *curr) {
+	enum intr_level old_level = intr_disable ();
+	struct runqueue *rq = &this_cpu ()->rq;
+	bool outranks;
+
+	spin_lock (&rq->lock);
+	if (!list_empty (&rq->edf)) {
+		struct thread *t = list_entry (list_front (&rq->edf),
+				struct thread, elem);
+
+		outranks = !is_edf (curr) || t->dl_deadline < curr->dl_deadline;
+	} else if (rq->bitmap == 0 || is_edf (curr))
+		outranks = false;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		outranks = is_idle (curr)
+			|| 63 - __builtin_clzll (rq->bitmap) > curr->priority;
+	spin_unlock (&rq->lock);
+	intr_set_level (old_level);
+	return outranks;
+}
+
+/* Returns the number of threads in all CPUs' run queues. */
+static int
+ready_threads_cnt (void) {
+	int cnt = 0;
+	int i;
+
+	for (i = 0; i < cpu_cnt; i++)
+		cnt += cpus[i].rq.cnt;
+	return cnt;
+}
+
+/* Returns true if T is the idle thread of its CPU. */
+static bool
+is_idle (const struct thread *t) {
+	return t->cpu != NULL && t == t->cpu->idle;
+}
+
+/* Returns true if T is in the deadline class. */
+static bool
+is_edf (const struct thread *t) {
+	return t->dl_period > 0;
+}
+
+/* Orders deadline threads by the end of their current period. */
+static bool
+cmp_deadline (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct thread, elem)->dl_deadline
+		< list_entry (b, struct thread, elem)->dl_deadline;
 }
 
 /* Use iretq to launch the thread */
@@ -765,10 +1312,20 @@ do_iret (struct intr_frame *tf) {
    added at the end of the function. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
+	struct thread *curr = running_thread ();
+	uint64_t tf_cur = (uint64_t) &curr->tf;
 	uint64_t tf = (uint64_t) &th->tf;
 	ASSERT (intr_get_level () == INTR_OFF);
 
+	/* Fast path: save only the callee-saved registers on our own
+	 * stack.  A thread that last left through here is resumed with
+	 * a plain ret; anything else still goes through do_iret. */
+	if (!thread_slow_switch) {
+		ASSERT (curr->switch_rsp == 0);
+		switch_threads (&curr->switch_rsp, &th->switch_rsp, &th->tf);
+		return;
+	}
+
 	/* The main switching logic.
 	 * We first restore the whole execution context into the intr_frame
 	 * and then switching to the next thread by calling do_iret.
@@ -833,7 +1390,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -851,7 +1408,11 @@ schedule (void) {
 	next->status = THREAD_RUNNING;
 
 	/* Start new time slice. */
-	thread_ticks = 0;
+	if (next->cpu != curr->cpu)
+		curr->cpu->migrations++;
+	next->cpu = curr->cpu;
+	next->cpu->curr = next;
+	next->cpu->thread_ticks = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -859,6 +1420,12 @@ schedule (void) {
 #endif
 
 	if (curr != next) {
+		trace_event (TRACE_SWITCH, curr->tid, next->tid);
+		if (curr->status == THREAD_BLOCKED)
+			curr->nvcsw++;
+		else if (curr->status == THREAD_READY)
+			curr->nivcsw++;
+
 		/* If the thread we switched from is dying, destroy its struct
 		   thread. This must happen late so that thread_exit() doesn't
 		   pull out the rug under itself.
@@ -873,10 +1440,45 @@ schedule (void) {
 
 		/* Before switching the thread, we first save the information
 		 * of current running. */
+		fpu_switch (next);
 		thread_launch (next);
 	}
 }
 
+/* Returns a page for a new thread, recycled from the thread cache
+   if possible, or a null pointer if memory is exhausted.  The page
+   is not zeroed. */
+static struct thread *
+thread_page_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	if (!list_empty (&thread_cache)) {
+		t = list_entry (list_pop_front (&thread_cache), struct thread, elem);
+		thread_cache_cnt--;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (0);
+	return t;
+}
+
+/* Returns the page of dead thread T to the thread cache, or to the
+   page allocator if the cache is full. */
+static void
+thread_page_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (thread_cache_cnt < THREAD_CACHE_MAX) {
+		t->magic = 0;           /* Stale pointers must fail is_thread(). */
+		list_push_front (&thread_cache, &t->elem);
+		thread_cache_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -890,6 +1492,14 @@ allocate_tid (void) {
 	return tid;
 }
 
+/* Orders sleeping threads by the tick they are due to wake up. */
+static bool
+cmp_awake_ticks (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct thread, elem)->awake_ticks
+		< list_entry (b, struct thread, elem)->awake_ticks;
+}
+
 bool cmp_priority (const struct list_elem *a,const struct list_elem *b, void *aux UNUSED){
 	
 	ASSERT(a != NULL);
@@ -904,33 +1514,137 @@ bool cmp_priority (const struct list_elem *a,const struct list_elem *b, void *au
 	}
 }
 
-struct thread *find_thread_for_tid(int tid){
-	struct list_elem *ptr = list_begin(&all_list);
-	while(ptr != list_end(&all_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, a_elem);
-		if(curr->tid == tid) {
-			return curr;
-		}
-		ptr = list_next(ptr);
-	}
+/* Returns the record of the current thread's child TID, or NULL if
+   TID is not a child of the current thread or has been released
+   already.  The child may have exited. */
+struct child_info *
+find_child_for_tid (int tid) {
+	struct thread *curr = thread_current ();
+	struct child_info key;
+	struct hash_elem *e;
+
+	if (!curr->has_children)
+		return NULL;
+	key.tid = tid;
+	e = hash_find (&curr->children, &key.elem);
+	return e != NULL ? hash_entry (e, struct child_info, elem) : NULL;
 }
 
-struct thread *find_child_for_tid(int tid){
-	struct list_elem *ptr = list_begin(&thread_current()->child_list);
-	struct thread *result;
-	int count = 0;
-	while(ptr != list_end(&thread_current()->child_list)) {
-		struct thread *curr = list_entry(ptr, struct thread, c_elem);
-		if(curr->tid == tid) {
-			result = curr;
-			count++;
-		}
-		ptr = list_next(ptr);
+/* Removes CHILD, a record returned by find_child_for_tid(), from the
+   current thread's children, e.g. once its exit status has been
+   collected. */
+void
+release_child (struct child_info *child) {
+	struct thread *curr = thread_current ();
+
+	ASSERT (curr->has_children);
+
+	hash_delete (&curr->children, &child->elem);
+	child_info_put (child);
+}
+
+/* Creates the record of new thread CHILD and files it in tid_table
+   and, if WAITABLE, among PARENT's children.  The record starts
+   with one reference for CHILD and, if WAITABLE, one for PARENT.
+   Returns false if out of memory. */
+static bool
+register_child (struct thread *parent, struct thread *child,
+		bool waitable) {
+	struct child_info *info;
+
+	if (waitable && !parent->has_children) {
+		if (!hash_init (&parent->children, child_hash, child_less, NULL))
+			return false;
+		parent->has_children = true;
 	}
-	if(count == 1){
-		return result;
-	} else {
-		return NULL;
+	info = kmem_cache_alloc (child_info_cache);
+	if (info == NULL)
+		return false;
+
+	info->tid = child->tid;
+	info->thread = child;
+	info->exit_status = 0;
+	info->fork_failed = false;
+	info->refcnt = waitable ? 2 : 1;
+	sema_init (&info->fork_sema, 0);
+	sema_init (&info->exit_sema, 0);
+	if (waitable)
+		hash_insert (&parent->children, &info->elem);
+	child->child_info = info;
+
+	lock_acquire (&tid_lock);
+	hash_insert (&tid_table, &info->tid_elem);
+	lock_release (&tid_lock);
+	return true;
+}
+
+/* Called by exiting thread T.  Publishes T's exit status to its
+   parent and drops T's references to its own record and to those
+   of its children, which become orphans. */
+static void
+unregister_thread (struct thread *t) {
+	struct child_info *info = t->child_info;
+
+	if (t->has_children) {
+		hash_destroy (&t->children, child_orphan);
+		t->has_children = false;
 	}
+	if (info == NULL)
+		return;
+
+	lock_acquire (&tid_lock);
+	hash_delete (&tid_table, &info->tid_elem);
+	lock_release (&tid_lock);
+
+	info->thread = NULL;
+	info->exit_status = t->sys_stat;
+	sema_up (&info->exit_sema);
+	t->child_info = NULL;
+	child_info_put (info);
 }
 
+/* Drops a reference to INFO, freeing it when the last one goes. */
+static void
+child_info_put (struct child_info *info) {
+	enum intr_level old_level;
+	bool last;
+
+	old_level = intr_disable ();
+	last = --info->refcnt == 0;
+	intr_set_level (old_level);
+
+	if (last)
+		kmem_cache_free (child_info_cache, info);
+}
+
+/* hash_destroy() callback for an exiting parent's children. */
+static void
+child_orphan (struct hash_elem *e, void *aux UNUSED) {
+	child_info_put (hash_entry (e, struct child_info, elem));
+}
+
+/* Hashes a parent's children by tid. */
+static uint64_t
+child_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct child_info, elem)->tid);
+}
+
+static bool
+child_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct child_info, elem)->tid
+		< hash_entry (b, struct child_info, elem)->tid;
+}
+
+/* Hashes tid_table by tid. */
+static uint64_t
+tid_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct child_info, tid_elem)->tid);
+}
+
+static bool
+tid_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct child_info, tid_elem)->tid
+		< hash_entry (b, struct child_info, tid_elem)->tid;
+}
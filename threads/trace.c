@@ -0,0 +1,184 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Scheduler event tracing.
+
+   Each CPU records into its own ring buffer, with interrupts off,
+   so recording takes no lock and CPUs never contend.  When a ring
+   is full the oldest events are overwritten.  Timestamps come
+   from the time-stamp counter, in CPU cycles. */
+
+#define TRACE_PAGES 4           /* Size of each CPU's ring, in pages. */
+
+/* One event. */
+struct trace_rec {
+	uint64_t tsc;               /* Time-stamp counter. */
+	int32_t tid;                /* Thread the event is about. */
+	uint8_t type;               /* enum trace_type. */
+	int64_t arg;                /* Event-specific. */
+};
+
+/* Ring buffer of one CPU. */
+struct trace_ring {
+	struct trace_rec *recs;     /* TRACE_PAGES pages, or NULL. */
+	size_t cap;                 /* # of entries in `recs'. */
+	uint64_t head;              /* # of events ever recorded. */
+};
+
+/* See trace.h. */
+bool trace_enabled;
+
+static struct trace_ring rings[CPU_MAX];
+
+static const char *type_names[TRACE_TYPE_CNT] = {
+	"switch", "block", "unblock", "lock-wait", "lock-got", "timer",
+};
+
+static void dump_ring (int cpu, const struct trace_ring *);
+static const struct trace_rec *ring_at (const struct trace_ring *, uint64_t);
+
+/* Allocates the ring buffers of the online CPUs, if tracing is
+   enabled.  Called once the page allocator is up; events before
+   then are dropped. */
+void
+trace_init (void) {
+	int i;
+
+	if (!trace_enabled)
+		return;
+	for (i = 0; i < cpu_cnt; i++) {
+		struct trace_rec *recs = palloc_get_multiple (0, TRACE_PAGES);
+
+		if (recs == NULL) {
+			printf ("trace: no memory for CPU %d, tracing disabled\n", i);
+			trace_enabled = false;
+			return;
+		}
+		rings[i].cap = TRACE_PAGES * PGSIZE / sizeof *recs;
+		rings[i].head = 0;
+		barrier ();
+		rings[i].recs = recs;
+	}
+}
+
+/* Records an event of kind TYPE about thread TID in this CPU's
+   ring.  May be called from any context, including interrupt
+   handlers and the scheduler itself. */
+void
+trace_event (enum trace_type type, tid_t tid, int64_t arg) {
+	enum intr_level old_level;
+	struct trace_ring *r;
+
+	if (!trace_enabled)
+		return;
+
+	old_level = intr_disable ();
+	r = &rings[this_cpu ()->id];
+	if (r->recs != NULL) {
+		struct trace_rec *e = &r->recs[r->head % r->cap];
+
+		e->tsc = rdtsc ();
+		e->tid = tid;
+		e->type = type;
+		e->arg = arg;
+		r->head++;
+	}
+	intr_set_level (old_level);
+}
+
+/* Prints the events still held in every CPU's ring, oldest first,
+   followed by the wakeup-to-run latency and lock wait time that
+   can be matched up within each ring.  Recording is paused
+   meanwhile.  Called at shutdown, or from anywhere for a dump on
+   demand. */
+void
+trace_dump (void) {
+	bool was_enabled = trace_enabled;
+	int i;
+
+	if (!was_enabled)
+		return;
+	trace_enabled = false;
+	for (i = 0; i < cpu_cnt; i++)
+		if (rings[i].recs != NULL)
+			dump_ring (i, &rings[i]);
+	trace_enabled = was_enabled;
+}
+
+/* Prints RING, the ring of CPU number CPU. */
+static void
+dump_ring (int cpu, const struct trace_ring *r) {
+	uint64_t first = r->head > r->cap ? r->head - r->cap : 0;
+	uint64_t base, n;
+	uint64_t wake_sum = 0, wake_max = 0, wake_cnt = 0;
+	uint64_t lock_sum = 0, lock_max = 0, lock_cnt = 0;
+
+	if (first == r->head)
+		return;
+	base = ring_at (r, first)->tsc;
+	printf ("Trace CPU %d: %llu events (%llu dropped), cycles since first\n",
+			cpu, r->head - first, first);
+
+	for (n = first; n < r->head; n++) {
+		const struct trace_rec *e = ring_at (r, n);
+		enum trace_type match;
+		tid_t tid;
+		uint64_t m;
+
+		printf ("%12llu %-9s tid %d arg %lld\n",
+				e->tsc - base, type_names[e->type], e->tid, e->arg);
+
+		/* Pair a switch with the wakeup before it, and a lock
+		   acquisition with the wait before it. */
+		if (e->type == TRACE_SWITCH) {
+			match = TRACE_UNBLOCK;
+			tid = e->arg;
+		} else if (e->type == TRACE_LOCK_GOT) {
+			match = TRACE_LOCK_WAIT;
+			tid = e->tid;
+		} else
+			continue;
+		for (m = n; m-- > first; ) {
+			const struct trace_rec *p = ring_at (r, m);
+			uint64_t delta = e->tsc - p->tsc;
+
+			/* Switched back in without a wakeup: was preempted. */
+			if (match == TRACE_UNBLOCK
+					&& p->type == TRACE_SWITCH && p->arg == tid)
+				break;
+			if (p->type != match || p->tid != tid)
+				continue;
+			if (match == TRACE_UNBLOCK) {
+				wake_sum += delta;
+				wake_cnt++;
+				if (delta > wake_max)
+					wake_max = delta;
+			} else {
+				lock_sum += delta;
+				lock_cnt++;
+				if (delta > lock_max)
+					lock_max = delta;
+			}
+			break;
+		}
+	}
+
+	if (wake_cnt > 0)
+		printf ("Trace CPU %d: wakeup-to-run %llu samples, avg %llu, max %llu cycles\n",
+				cpu, wake_cnt, wake_sum / wake_cnt, wake_max);
+	if (lock_cnt > 0)
+		printf ("Trace CPU %d: lock wait %llu samples, avg %llu, max %llu cycles\n",
+				cpu, lock_cnt, lock_sum / lock_cnt, lock_max);
+}
+
+/* Returns event number N of ring R. */
+static const struct trace_rec *
+ring_at (const struct trace_ring *r, uint64_t n) {
+	return &r->recs[n % r->cap];
+}
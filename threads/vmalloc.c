@@ -0,0 +1,146 @@
+#include "threads/vmalloc.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include "threads/init.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Virtually contiguous kernel allocations.
+
+   vmalloc() backs a run of kernel virtual pages in the area
+   starting at VMALLOC_START with individual pages from the page
+   allocator, so a multi-page buffer needs no physically contiguous
+   run and does not fail when the kernel pool is fragmented.
+
+   The area lies in the same PML4 slot as the rest of the kernel,
+   whose page-directory-pointer table every process's pml4 shares
+   (see pml4_create()), so mappings made here are visible in every
+   address space.  Each allocation is followed by an unmapped guard
+   page, which catches overruns and tells vfree() where the
+   allocation ends. */
+
+static struct bitmap *vm_used;  /* Reserved pages of the area. */
+static struct lock vm_lock;     /* Protects vm_used. */
+
+static uint64_t *vm_pte (const void *va, bool create);
+static void vm_unmap (uint8_t *va, size_t page_cnt);
+static void vm_release (uint8_t *va, size_t page_cnt);
+
+/* Initializes the vmalloc() area.  Must be called after
+   paging_init() and malloc_init(). */
+void
+vmalloc_init (void) {
+	lock_init (&vm_lock);
+	vm_used = bitmap_create (VMALLOC_PAGES);
+	if (vm_used == NULL)
+		PANIC ("vmalloc_init: out of memory");
+}
+
+/* Allocates SIZE bytes, rounded up to whole pages, of virtually
+   contiguous kernel memory and returns its page-aligned start.
+   Returns a null pointer if memory or address space runs out. */
+void *
+vmalloc (size_t size) {
+	size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+	size_t idx, i;
+	uint8_t *va;
+
+	if (size == 0 || vm_used == NULL)
+		return NULL;
+
+	/* Reserve the pages and the guard page after them. */
+	lock_acquire (&vm_lock);
+	idx = bitmap_scan_and_flip (vm_used, 0, page_cnt + 1, false);
+	lock_release (&vm_lock);
+	if (idx == BITMAP_ERROR)
+		return NULL;
+	va = (uint8_t *) VMALLOC_START + idx * PGSIZE;
+
+	for (i = 0; i < page_cnt; i++) {
+		void *kpage = palloc_get_page (0);
+		uint64_t *pte = kpage != NULL ? vm_pte (va + i * PGSIZE, true) : NULL;
+
+		if (pte == NULL) {
+			/* Undo the I pages mapped so far and give back the
+			   whole reservation, guard page included. */
+			palloc_free_page (kpage);
+			vm_unmap (va, i);
+			vm_release (va, page_cnt + 1);
+			return NULL;
+		}
+		*pte = vtop (kpage) | PTE_P | PTE_W;
+	}
+	return va;
+}
+
+/* Frees P, which must have been returned by vmalloc(). */
+void
+vfree (void *p) {
+	size_t page_cnt;
+
+	if (p == NULL)
+		return;
+	ASSERT (is_vmalloc_vaddr (p));
+	ASSERT (pg_ofs (p) == 0);
+
+	/* The pages run up to the guard page. */
+	page_cnt = vmalloc_size (p) / PGSIZE;
+	vm_unmap (p, page_cnt);
+	vm_release (p, page_cnt + 1);
+}
+
+/* Returns the number of bytes mapped for P, which must have been
+   returned by vmalloc(). */
+size_t
+vmalloc_size (const void *p) {
+	const uint8_t *va = p;
+	size_t page_cnt = 0;
+	uint64_t *pte;
+
+	ASSERT (is_vmalloc_vaddr (p));
+
+	while ((pte = vm_pte (va + page_cnt * PGSIZE, false)) != NULL
+			&& (*pte & PTE_P))
+		page_cnt++;
+	return page_cnt * PGSIZE;
+}
+
+/* Unmaps the PAGE_CNT pages starting at VA and frees the
+   physical pages behind them. */
+static void
+vm_unmap (uint8_t *va, size_t page_cnt) {
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++) {
+		uint64_t *pte = vm_pte (va + i * PGSIZE, false);
+
+		ASSERT (pte != NULL && (*pte & PTE_P));
+		palloc_free_page (ptov (PTE_ADDR (*pte)));
+		*pte = 0;
+		invlpg ((uint64_t) va + i * PGSIZE);
+	}
+}
+
+/* Returns the PAGE_CNT pages of address space starting at VA to
+   the area. */
+static void
+vm_release (uint8_t *va, size_t page_cnt) {
+	size_t idx = ((uint64_t) va - VMALLOC_START) / PGSIZE;
+
+	lock_acquire (&vm_lock);
+	ASSERT (bitmap_all (vm_used, idx, page_cnt));
+	bitmap_set_multiple (vm_used, idx, page_cnt, false);
+	lock_release (&vm_lock);
+}
+
+/* Returns the page table entry for VA in the kernel's page
+   tables, creating missing tables if CREATE is true. */
+static uint64_t *
+vm_pte (const void *va, bool create) {
+	ASSERT (is_vmalloc_vaddr (va));
+	return pml4e_walk (base_pml4, (uint64_t) va, create);
+}
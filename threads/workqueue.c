@@ -0,0 +1,398 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Workqueues.
+
+   A workqueue is a list of pending work served by a fixed pool
+   of worker threads created along with it.  Queueing only touches
+   the list and a semaphore with interrupts off, so interrupt
+   handlers may queue work too, and so may the timer, which is how
+   delayed work gets queued once it expires.
+
+   A worker never touches a piece of work after calling its
+   function, since the function may free it.  Instead each worker
+   remembers which work it is running, and flush_work() looks
+   there. */
+
+#define SYSTEM_WQ_WORKERS 2     /* # of workers serving system_wq. */
+
+/* A worker thread. */
+struct worker {
+	struct workqueue *wq;           /* Queue it serves. */
+	struct work *current;           /* Work being run, or NULL. */
+};
+
+/* A queue and its pool of workers. */
+struct workqueue {
+	const char *name;               /* Prefix of the workers' names. */
+	struct list works;              /* Pending work, oldest first. */
+	struct semaphore avail;         /* Ups once per queued work. */
+	int busy;                       /* # of works pending or running. */
+	struct semaphore flushed;       /* Threads in flush_*() sleep here. */
+	unsigned flusher_cnt;           /* # of threads sleeping on `flushed'. */
+	int worker_cnt;                 /* # of entries in `workers'. */
+	struct worker workers[];        /* The pool. */
+};
+
+/* See workqueue.h. */
+struct workqueue *system_wq;
+
+/* Armed delayed work, earliest first. */
+static struct list timers;
+
+static thread_func worker_thread;
+static bool timer_less (const struct list_elem *, const struct list_elem *,
+		void *aux);
+static bool work_busy (struct work *);
+static void flush_wait (struct workqueue *);
+static void flush_wake (struct workqueue *);
+
+/* Initializes the workqueue subsystem.  Must be called before
+   the timer interrupt is enabled. */
+void
+workqueue_init (void) {
+	list_init (&timers);
+}
+
+/* Creates system_wq.  Must be called after thread_start(). */
+void
+workqueue_start (void) {
+	system_wq = workqueue_create ("events", SYSTEM_WQ_WORKERS, PRI_DEFAULT);
+	if (system_wq == NULL)
+		PANIC ("could not create system workqueue");
+}
+
+/* Queues every delayed work whose timer expired by tick NOW.
+   Called by the timer interrupt handler. */
+void
+workqueue_tick (int64_t now) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (!list_empty (&timers)) {
+		struct delayed_work *dw =
+			list_entry (list_front (&timers), struct delayed_work, timer_elem);
+
+		if (dw->expires > now)
+			break;
+		list_pop_front (&timers);
+		dw->armed = false;
+		queue_work (dw->work.wq, &dw->work);
+	}
+}
+
+/* Returns the tick at which the next delayed work expires, or
+   INT64_MAX if none is armed.  Interrupts must be off. */
+int64_t
+workqueue_next_expiry (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&timers))
+		return INT64_MAX;
+	return list_entry (list_front (&timers),
+			struct delayed_work, timer_elem)->expires;
+}
+
+/* Creates a queue served by WORKERS threads of the given
+   PRIORITY, named after NAME, which must outlive the queue.
+   Returns a null pointer if memory or threads run out. */
+struct workqueue *
+workqueue_create (const char *name, int workers, int priority) {
+	struct workqueue *wq;
+	int i;
+
+	ASSERT (workers > 0);
+
+	wq = malloc (sizeof *wq + workers * sizeof *wq->workers);
+	if (wq == NULL)
+		return NULL;
+	wq->name = name;
+	list_init (&wq->works);
+	sema_init (&wq->avail, 0);
+	wq->busy = 0;
+	sema_init (&wq->flushed, 0);
+	wq->flusher_cnt = 0;
+	wq->worker_cnt = workers;
+
+	for (i = 0; i < workers; i++) {
+		struct worker *w = &wq->workers[i];
+		char thread_name[16];
+
+		w->wq = wq;
+		w->current = NULL;
+		snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+		if (thread_create (thread_name, priority, worker_thread, w)
+				== TID_ERROR) {
+			if (i == 0) {
+				free (wq);
+				return NULL;
+			}
+			/* Make do with the workers already started. */
+			wq->worker_cnt = i;
+			break;
+		}
+	}
+	return wq;
+}
+
+/* Initializes WORK to run FUNC. */
+void
+work_init (struct work *work, work_func *func) {
+	ASSERT (work != NULL);
+	ASSERT (func != NULL);
+
+	work->func = func;
+	work->wq = NULL;
+	work->pending = false;
+}
+
+/* Initializes DW to run FUNC. */
+void
+delayed_work_init (struct delayed_work *dw, work_func *func) {
+	work_init (&dw->work, func);
+	dw->armed = false;
+}
+
+/* Appends WORK to WQ, to be run by one of WQ's workers.  Returns
+   false, doing nothing, if WORK is already pending.  Work that is
+   running may be queued again.  May be called from an interrupt
+   handler. */
+bool
+queue_work (struct workqueue *wq, struct work *work) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	ASSERT (wq != NULL);
+	ASSERT (work != NULL);
+
+	old_level = intr_disable ();
+	if (!work->pending) {
+		work->pending = true;
+		work->wq = wq;
+		list_push_back (&wq->works, &work->elem);
+		wq->busy++;
+		sema_up (&wq->avail);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Queues DW's work on WQ once TICKS timer ticks have passed, or
+   right away if TICKS <= 0.  Returns false, doing nothing, if DW
+   is already armed or pending.  May be called from an interrupt
+   handler. */
+bool
+queue_delayed_work (struct workqueue *wq, struct delayed_work *dw,
+		int64_t ticks) {
+	enum intr_level old_level;
+	bool queued = false;
+
+	if (ticks <= 0)
+		return queue_work (wq, &dw->work);
+
+	old_level = intr_disable ();
+	if (!dw->armed && !dw->work.pending) {
+		dw->work.wq = wq;
+		dw->expires = timer_ticks () + ticks;
+		dw->armed = true;
+		list_insert_ordered (&timers, &dw->timer_elem, timer_less, NULL);
+		queued = true;
+	}
+	intr_set_level (old_level);
+	return queued;
+}
+
+/* Queues WORK on system_wq.  See queue_work(). */
+bool
+schedule_work (struct work *work) {
+	return queue_work (system_wq, work);
+}
+
+/* Queues DW on system_wq after TICKS ticks.  See
+   queue_delayed_work(). */
+bool
+schedule_delayed_work (struct delayed_work *dw, int64_t ticks) {
+	return queue_delayed_work (system_wq, dw, ticks);
+}
+
+/* Takes WORK off its queue if it has not started yet.  Returns
+   true if it was pending.  Does not wait for a running WORK; see
+   cancel_work_sync(). */
+bool
+cancel_work (struct work *work) {
+	enum intr_level old_level;
+	bool was_pending;
+
+	old_level = intr_disable ();
+	was_pending = work->pending;
+	if (was_pending) {
+		list_remove (&work->elem);
+		work->pending = false;
+		work->wq->busy--;
+		/* The worker woken for WORK finds nothing and waits again
+		   without waking anyone, so wake the flushers here: WORK
+		   may have been all they were waiting for. */
+		flush_wake (work->wq);
+	}
+	intr_set_level (old_level);
+	return was_pending;
+}
+
+/* Cancels WORK and waits for a running instance of it to finish.
+   Afterward WORK is idle, unless its function requeued it.
+   Returns true if it was pending. */
+bool
+cancel_work_sync (struct work *work) {
+	bool was_pending = cancel_work (work);
+
+	flush_work (work);
+	return was_pending;
+}
+
+/* Disarms DW, or takes its work off the queue if the timer
+   already expired.  Returns true if either was pending. */
+bool
+cancel_delayed_work (struct delayed_work *dw) {
+	enum intr_level old_level;
+	bool was_armed;
+
+	old_level = intr_disable ();
+	was_armed = dw->armed;
+	if (was_armed) {
+		list_remove (&dw->timer_elem);
+		dw->armed = false;
+	}
+	intr_set_level (old_level);
+	return cancel_work (&dw->work) || was_armed;
+}
+
+/* Like cancel_delayed_work(), and also waits for DW's function
+   if it is running. */
+bool
+cancel_delayed_work_sync (struct delayed_work *dw) {
+	bool was_pending = cancel_delayed_work (dw);
+
+	flush_work (&dw->work);
+	return was_pending;
+}
+
+/* Waits until WORK is neither pending nor running.  Must not be
+   called by the work itself. */
+void
+flush_work (struct work *work) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (work->wq != NULL && work_busy (work))
+		flush_wait (work->wq);
+	intr_set_level (old_level);
+}
+
+/* Waits until WQ has no work pending or running.  Work queued in
+   the meantime is waited for as well.  Must not be called from
+   one of WQ's workers. */
+void
+flush_workqueue (struct workqueue *wq) {
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	while (wq->busy > 0)
+		flush_wait (wq);
+	intr_set_level (old_level);
+}
+
+/* Returns true if WORK is pending or one of its queue's workers
+   is running it.  Interrupts must be off. */
+static bool
+work_busy (struct work *work) {
+	struct workqueue *wq = work->wq;
+	int i;
+
+	if (work->pending)
+		return true;
+	for (i = 0; i < wq->worker_cnt; i++)
+		if (wq->workers[i].current == work)
+			return true;
+	return false;
+}
+
+/* Sleeps until one of WQ's works completes or is cancelled.  Interrupts
+   must be off. */
+static void
+flush_wait (struct workqueue *wq) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	wq->flusher_cnt++;
+	sema_down (&wq->flushed);
+}
+
+/* Wakes every thread sleeping in flush_wait() on WQ, so each
+   can check whether what it waits for is done.  They are all
+   made ready before a single preemption check.  Interrupts must
+   be off. */
+static void
+flush_wake (struct workqueue *wq) {
+	unsigned cnt = wq->flusher_cnt;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Reset first: a woken flusher may run, and wait again, before
+	   sema_up_many() returns. */
+	wq->flusher_cnt = 0;
+	if (cnt > 0)
+		sema_up_many (&wq->flushed, cnt);
+}
+
+/* Body of a worker thread: runs work from its queue, oldest
+   first, forever. */
+static void
+worker_thread (void *w_) {
+	struct worker *w = w_;
+	struct workqueue *wq = w->wq;
+
+	for (;;) {
+		enum intr_level old_level;
+		struct work *work;
+		work_func *func;
+
+		sema_down (&wq->avail);
+
+		old_level = intr_disable ();
+		if (list_empty (&wq->works)) {
+			/* Cancelled before we got to it. */
+			intr_set_level (old_level);
+			continue;
+		}
+		work = list_entry (list_pop_front (&wq->works), struct work, elem);
+		work->pending = false;
+		w->current = work;
+		func = work->func;
+		intr_set_level (old_level);
+
+		func (work);
+
+		old_level = intr_disable ();
+		w->current = NULL;
+		wq->busy--;
+		flush_wake (wq);
+		intr_set_level (old_level);
+	}
+}
+
+/* Orders delayed work by expiry time. */
+static bool
+timer_less (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct delayed_work, timer_elem)->expires
+		< list_entry (b, struct delayed_work, timer_elem)->expires;
+}
@@ -11,6 +11,7 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
@@ -59,10 +60,7 @@ process_create_initd (const char *file_name) {
 	tmp = strtok_r(file_name, " ", &dummy);
 
 	/* Create a new thread to execute FILE_NAME. */
-	tid = thread_create (tmp, PRI_DEFAULT, initd, fn_copy);
-	// 강철구
-	struct thread *child = find_thread_for_tid(tid);
-
+	tid = thread_create_child (tmp, PRI_DEFAULT, initd, fn_copy);
 	
 	if (tid == TID_ERROR)
 		palloc_free_page (fn_copy);
@@ -92,14 +90,16 @@ tid_t
 process_fork (const char *name, struct intr_frame *if_ UNUSED) {
 	memcpy(&thread_current()->for_copy, if_, sizeof(struct intr_frame));
 
-	tid_t tid = thread_create (name, PRI_MAX, __do_fork, thread_current ());
+	tid_t tid = thread_create_child (name, PRI_MAX, __do_fork, thread_current ());
 	if (tid == TID_ERROR) {
 		return TID_ERROR;
 	}
-	struct thread *child = find_child_for_tid(tid);
+	struct child_info *child = find_child_for_tid(tid);
 
 	sema_down(&child->fork_sema);
-	if (child->sys_stat == -1) {
+	if (child->fork_failed) {
+		// 실패한 자식은 wait 할 수 없으니 기록을 바로 정리한다
+		release_child(child);
 		return TID_ERROR;
 	}
 
@@ -178,6 +178,8 @@ __do_fork (void *aux) {
 		goto error;
 	}
 #endif
+	if (!fpu_fork (current, parent))
+		goto error;
 
 	/* TODO: Your code goes here.
 	 * TODO: Hint) To duplicate the file object, use `file_duplicate`
@@ -193,7 +195,7 @@ __do_fork (void *aux) {
 	}
 	
 	// 강철구
-	sema_up(&current->fork_sema);
+	sema_up(&current->child_info->fork_sema);
 	process_init ();
 
 	/* Finally, switch to the newly created process. */
@@ -203,7 +205,9 @@ __do_fork (void *aux) {
 		do_iret (&if_);
 	}
 error:
-	sema_up(&current->fork_sema);
+	current->child_info->fork_failed = true;
+	current->sys_stat = -1;
+	sema_up(&current->child_info->fork_sema);
 	thread_exit ();
 }
 
@@ -257,27 +261,17 @@ process_exec (void *f_name) {
 int
 process_wait (tid_t child_tid UNUSED) {
 
-	struct thread *curr = thread_current();
-	struct thread *child = find_child_for_tid(child_tid);
+	// 자식의 child_info 는 자식이 이미 끝났어도 남아 있다
+	struct child_info *child = find_child_for_tid(child_tid);
 
 	if (child == NULL) {
-		// sema_up(&child->exit_sema);
-		return -1;
-	}
-		
-
-	
-	if (child->status == -1){
-		// sema_up(&cmakhild->exit_sema);
 		return -1;
 	}
 
-	sema_down(&child->wait_sema);
-
-	int sys_stat = child->sys_stat;
-	list_remove(&child->c_elem);
+	sema_down(&child->exit_sema);
 
-	sema_up(&child->exit_sema);
+	int sys_stat = child->exit_status;
+	release_child(child);
 
 	return sys_stat;
 }
@@ -293,9 +287,6 @@ process_exit (void) {
 	// file_close(curr->current_file);
 
 
-	sema_up(&curr->wait_sema);
-	sema_down(&curr->exit_sema);
-
 	process_cleanup ();
 }
 
@@ -311,6 +302,8 @@ process_cleanup (void) {
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
 	 * to the kernel-only page directory. */
+	fpu_release (curr);
+
 	pml4 = curr->pml4;
 	if (pml4 != NULL) {
 		/* Correct ordering here is crucial.  We must set
@@ -509,7 +502,6 @@ load (const char *file_name, struct intr_frame *if_) {
 	////////////////////////////* 인자 스택 푸쉬 시작 */////////////////////////////////
 	
 	int cnt = 0;
-	int total_length = 0;
 	char *arr[64];
 	int *addr_arr[64];
 
@@ -518,7 +510,6 @@ load (const char *file_name, struct intr_frame *if_) {
 		if (ret_ptr == NULL) break;
 
 		arr[i] = ret_ptr;
-		total_length += strlen(ret_ptr)+1;
 		
         ret_ptr = strtok_r(NULL, " ", &next_ptr);	
 		cnt++;
@@ -536,11 +527,10 @@ load (const char *file_name, struct intr_frame *if_) {
 		addr_arr[x] = if_->rsp;
 	}
 
-	// 8의 배수로 패딩
-	int eightn = 8*((total_length/8)+1);
-
-	if_->rsp -= eightn-total_length;
-	
+	// 16의 배수로 패딩, argv 배열이 16바이트 경계에서 시작하도록 (SSE 스택 정렬)
+	if_->rsp &= ~(uintptr_t) 0xf;
+	if ((cnt + 1) % 2 != 0)
+		if_->rsp -= 8;
 
 	// 빈 주소값 넣기
 	if_->rsp -= 8;
@@ -10,6 +10,10 @@
 #include "filesys/filesys.h"
 #include "threads/palloc.h"
 #include "filesys/file.h"
+#include "threads/vaddr.h"
+#include "threads/mmu.h"
+#include <procstat.h>
+#include <string.h>
 
 
 
@@ -34,6 +38,9 @@ struct lock filesys_lock;
 
 bool syscall_create(char *file, unsigned initial_size);
 bool syscall_remove (const char *file);
+bool syscall_procstat (pid_t pid, struct proc_stat *st);
+bool syscall_setaffinity (pid_t pid, unsigned mask);
+int syscall_getaffinity (pid_t pid);
 
 void
 syscall_init (void) {
@@ -99,6 +106,15 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	case SYS_SEEK :
 		syscall_seek (f->R.rdi, f->R.rsi); 	
 		break;
+	case SYS_PROCSTAT :
+		f->R.rax = syscall_procstat (f->R.rdi, (struct proc_stat *) f->R.rsi);
+		break;
+	case SYS_SETAFFINITY :
+		f->R.rax = syscall_setaffinity (f->R.rdi, f->R.rsi);
+		break;
+	case SYS_GETAFFINITY :
+		f->R.rax = syscall_getaffinity (f->R.rdi);
+		break;
 	}
 }
 
@@ -279,6 +295,48 @@ bool syscall_remove (const char *file) {
 	return filesys_remove(f_copy);
 }
 
+// uaddr 가 현재 프로세스에 매핑되어 있고 쓰기 가능한 user 페이지인지 확인
+static bool user_page_writable (const void *uaddr) {
+	uint64_t *pte;
+
+	if(uaddr == NULL || !is_user_vaddr(uaddr)) return false;
+	pte = pml4e_walk(thread_current()->pml4, (uint64_t) uaddr, 0);
+	return pte != NULL && (*pte & PTE_P) && is_writable(pte);
+}
+
+// pid 프로세스 (0 이면 자기 자신) 의 CPU 사용 통계를 st 에 채운다. 살아있는 프로세스가 아니면 false
+bool syscall_procstat (pid_t pid, struct proc_stat *st) {
+	struct proc_stat tmp;
+	void *end = (char *) st + sizeof *st - 1;
+
+	// bad-pointer: 구조체가 걸친 두 페이지 모두 매핑되어 있고 쓰기 가능해야 한다
+	if(!user_page_writable(st) || !user_page_writable(end)){
+		syscall_exit(-1);
+	}
+
+	if(pid == 0) pid = thread_tid();
+	if(!thread_get_stat(pid, &tmp)) return false;
+	memcpy(st, &tmp, sizeof tmp);
+	return true;
+}
+
+// pid (자기 자신 또는 자식, 0 이면 자기 자신) 가 돌 수 있는 CPU 를 mask 로 제한한다
+bool syscall_setaffinity (pid_t pid, unsigned mask) {
+	if(pid == 0) pid = thread_tid();
+	if(pid != thread_tid() && find_child_for_tid(pid) == NULL) return false;
+	return thread_set_affinity(pid, mask);
+}
+
+// pid (자기 자신 또는 자식, 0 이면 자기 자신) 의 affinity mask 를 돌려준다. 없으면 -1
+int syscall_getaffinity (pid_t pid) {
+	unsigned mask;
+
+	if(pid == 0) pid = thread_tid();
+	if(pid != thread_tid() && find_child_for_tid(pid) == NULL) return -1;
+	if(!thread_get_affinity(pid, &mask)) return -1;
+	return mask;
+}
+
 // int
 // get_exit_child_process(pid_t pid){
 // 	struct thread * curr = thread_current();